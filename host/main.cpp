@@ -0,0 +1,1873 @@
+// Native build of the game logic: replays recordings headless, checks the platform independent code and times it
+#include "game.h"
+#include "camera.h"
+#include "platform_host.h"
+#include "swizzle.h"
+#include "yuv.h"
+#include "orientation.h"
+#include "recording.h"
+#include "angular_grid.h"
+#include "splash_pool.h"
+#include "profiler.h"
+#include "optical_flow.h"
+#include "palette.h"
+#include "jobs.h"
+#include "stereo.h"
+#include "capture_governor.h"
+#include "capture_ring.h"
+#include "random.h"
+#include "timer_wheel.h"
+#include "waves.h"
+#include "damage.h"
+#include "memory.h"
+#include "frame_arena.h"
+#include "object_pool.h"
+#include "startup.h"
+#include "panorama.h"
+#include "decal_layer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// A made up session: the console sways a little while the beam is held on what's in front, then the aim is pushed on diagonally,
+// and the water type changes now and then
+// With stereo, 3D is switched on after a second
+static bool writeSyntheticLog(const char* path, u32 seconds, u32 seed, bool stereo = false)
+{
+    Recording::Writer writer;
+    if(!writer.open(path, seed, Platform::TICKS_PER_SECOND))
+        return false;
+
+    u32 state = seed;
+    auto next = [&state]() { state = state*1664525u + 1013904223u; return state; };
+
+    u32 frames = seconds*30;
+    u32 previousHeld = 0;
+    for(u32 i = 0; i < frames; i++)
+    {
+        float t = i/30.0f;
+        Recording::Frame frame;
+        frame.tick = 1 + (u64)i*Platform::TICKS_PER_SECOND/30;
+        frame.seed = next();
+        frame.keysHeld = 0;
+        if(i % 150 < 128)
+            frame.keysHeld |= KEY_A;
+        else
+            frame.keysHeld |= KEY_CPAD_RIGHT | KEY_CPAD_DOWN;
+        if(i % 300 == 150)
+            frame.keysHeld |= KEY_R;
+        if(i % 600 == 599)
+            frame.keysHeld |= KEY_X;
+        if(stereo && i == 30)
+            frame.keysHeld |= KEY_SELECT;
+        frame.keysDown = frame.keysHeld & ~previousHeld;
+        previousHeld = frame.keysHeld;
+
+        frame.gyro[0] = 60*std::sin(t*0.7f);
+        frame.gyro[1] = 90*std::sin(t*0.3f + 1);
+        frame.gyro[2] = 30*std::sin(t*1.1f + 2);
+        frame.accel[0] = 0;
+        frame.accel[1] = 0;
+        frame.accel[2] = 16384;
+        frame.motion[0] = frame.motion[1] = Recording::NO_MOTION;
+        for(u32 j = 0; j < Recording::PALETTE_COLORS; j++)
+            frame.palette[j] = (i/900) % 2 ? Platform::color32(0x30*j, 0x80, 0xFF - 0x30*j, 0xFF) : 0;
+        frame.reserved = 0;
+        writer.write(frame);
+    }
+    return true;
+}
+
+// The console held still on a table while the player keeps the beam on a splash until it's dead, emptying and refilling the water,
+// then hops it to the next one, at any frame rate
+// The D-pad is tapped every other step while hopping, on the first frame of the step, the game stepping 30 times a second
+// Uneven frames come up to half a frame early, but not right before a tap, which would give it to the step before
+// A yaw rate is a gyroscope biased around gravity, turning tZ away from the splashes while the aim stays on them
+static bool writeSteadyLog(const char* path, u32 seconds, u32 rate, bool uneven = false, s16 yawRate = 0)
+{
+    Recording::Writer writer;
+    if(!writer.open(path, 5, Platform::TICKS_PER_SECOND))
+        return false;
+
+    auto hopping = [](u32 step) { return step % 420 >= 368; };
+    Random random(rate);
+    for(u32 i = 0; i < seconds*rate; i++)
+    {
+        Recording::Frame frame = {};
+        u32 step = i*30/rate;
+        frame.tick = 1 + (u64)i*Platform::TICKS_PER_SECOND/rate;
+        if(uneven && i > 0 && !hopping(step + 1))
+            frame.tick -= random.below(Platform::TICKS_PER_SECOND/rate/2);
+        frame.keysHeld = KEY_A;
+        if(hopping(step) && step % 2 == 0 && i*30 % rate < 30)
+        {
+            // 26 taps right and 21 down, from the first splash to the next
+            u32 tap = (step % 420 - 368)/2;
+            frame.keysDown = tap < 21 ? KEY_RIGHT | KEY_DOWN : KEY_RIGHT;
+            frame.keysHeld |= frame.keysDown;
+        }
+        frame.accel[2] = 16384;
+        frame.gyro[2] = yawRate;
+        frame.motion[0] = frame.motion[1] = Recording::NO_MOTION;
+        writer.write(frame);
+    }
+    return true;
+}
+
+// The console held still on the splash in front at the start: white water is fired at it once full again,
+// stealing its color first when asked to, which kills it before the log ends and plain white water doesn't
+static bool writeStealLog(const char* path, bool steal)
+{
+    Recording::Writer writer;
+    if(!writer.open(path, 7, Platform::TICKS_PER_SECOND))
+        return false;
+
+    u32 previousHeld = 0;
+    for(u32 i = 0; i < 14*30; i++)
+    {
+        Recording::Frame frame = {};
+        frame.tick = 1 + (u64)i*Platform::TICKS_PER_SECOND/30;
+        if(i == 1)
+            frame.keysHeld = KEY_R;
+        else if(steal && i >= 5 && i < 35)
+            frame.keysHeld = KEY_Y;
+        else if(i >= 408)
+            frame.keysHeld = KEY_A;
+        frame.keysDown = frame.keysHeld & ~previousHeld;
+        previousHeld = frame.keysHeld;
+        frame.accel[2] = 16384;
+        frame.motion[0] = frame.motion[1] = Recording::NO_MOTION;
+        writer.write(frame);
+    }
+    return true;
+}
+
+typedef struct
+{
+    u32 frames;
+    int hitCounter;
+    size_t splashes;
+    u32 checksum;
+    double seconds;
+    bool shown; // the first frame was drawn
+} ReplayResult;
+
+// Without a wave script, unless one is given
+static ReplayResult replay(const char* path, const char* waves = "")
+{
+    char program[] = "paintar_host";
+    char* argv[] = {program, (char*)path, (char*)waves, NULL};
+
+    ReplayResult result = {};
+    auto start = Clock::now();
+    auto game = Memory::create<Game::Game>(Memory::TAG_GAME, 3, argv);
+    while(Platform::mainLoop() && game->running)
+    {
+        game->update();
+        if(game->running)
+            result.frames++;
+    }
+    result.seconds = secondsSince(start);
+    result.hitCounter = game->getHitCounter();
+    result.splashes = game->getSplashCount();
+    result.checksum = game->checksum();
+    result.shown = game->getStartup().reached(Startup::MILESTONE_FIRST_FRAME);
+    Memory::destroy(Memory::TAG_GAME, game);
+    return result;
+}
+
+static int failures = 0;
+
+static void check(bool condition, const char* what)
+{
+    printf("%s: %s\n", condition ? "ok" : "FAIL", what);
+    if(!condition)
+        failures++;
+}
+
+static void testSwizzle()
+{
+    constexpr u32 W = 400, H = 240, TW = 512;
+    std::vector<u16> src(W*H), tiled(TW*256), reference(TW*256);
+    for(u32 i = 0; i < src.size(); i++)
+        src[i] = i*2654435761u >> 16;
+
+    Swizzle::convertFrame<Swizzle::FORMAT_RGB565, W, H, TW>(src.data(), tiled.data());
+    for(u32 y = 0; y < H; y++)
+        for(u32 x = 0; x < W; x++)
+            reference[((y/8)*(TW/8) + x/8)*64 + Swizzle::mortonOffset(x % 8, y % 8)] = src[y*W + x];
+    check(tiled == reference, "swizzle matches the per-pixel layout");
+
+    // A 320 pixel wide picture in the same buffer leaves the tiles right of it alone
+    std::fill(tiled.begin(), tiled.end(), 0xDEAD);
+    Swizzle::convertTileRows<Swizzle::FORMAT_RGB565, W, TW>(src.data(), tiled.data(), 0, H/8, 320);
+    bool inside = true, outside = true;
+    for(u32 y = 0; y < H; y++)
+        for(u32 x = 0; x < W; x++)
+        {
+            u32 offset = ((y/8)*(TW/8) + x/8)*64 + Swizzle::mortonOffset(x % 8, y % 8);
+            if(x < 320)
+                inside &= tiled[offset] == reference[offset];
+            else
+                outside &= tiled[offset] == 0xDEAD;
+        }
+    check(inside && outside, "swizzle converts only the given width");
+}
+
+static void testYuv()
+{
+    // The fixed point steps stay within rounding of the BT.601 formulas, and gray stays gray
+    int worst = 0;
+    for(int y = 0; y < 256; y += 3)
+        for(int u = 0; u < 256; u += 5)
+            for(int v = 0; v < 256; v += 5)
+            {
+                u8 rgb[3];
+                Yuv::toRgb(y, u, v, &rgb[0], &rgb[1], &rgb[2]);
+                float exact[3] = {y + 1.402f*(v - 128), y - 0.344f*(u - 128) - 0.714f*(v - 128), y + 1.772f*(u - 128)};
+                for(u32 i = 0; i < 3; i++)
+                    worst = std::max(worst, std::abs(rgb[i] - (int)std::clamp(std::lround(exact[i]), 0l, 255l)));
+            }
+    u8 r, g, b;
+    Yuv::toRgb(200, 128, 128, &r, &g, &b);
+    check(worst <= 2 && std::abs(r - 200) <= 1 && std::abs(g - 200) <= 1 && std::abs(b - 200) <= 1, "YUV conversion follows BT.601");
+
+    constexpr u32 W = 400, H = 240, TW = 512;
+    std::vector<u16> src(W*H), tiled(TW*256, 0xDEAD), reference(TW*256, 0xDEAD);
+    for(u32 i = 0; i < src.size(); i++)
+        src[i] = i*2654435761u >> 16;
+
+    // Pairs of pixels share the U of the first and the V of the second
+    Yuv::convertTileRows<W, TW>(src.data(), tiled.data(), 0, H/8, 320);
+    for(u32 y = 0; y < H; y++)
+        for(u32 x = 0; x < 320; x++)
+        {
+            const u16* pair = &src[y*W + (x & ~1)];
+            reference[((y/8)*(TW/8) + x/8)*64 + Swizzle::mortonOffset(x % 8, y % 8)] = Yuv::toRgb565(src[y*W + x] & 0xFF, pair[0] >> 8, pair[1] >> 8);
+        }
+    check(tiled == reference, "YUV conversion lands in the swizzled layout");
+
+    // The Y2R unit and the CPU give the same texture, and the game uses the unit when there is one
+    startCameraThread({CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, 30, 1, Platform::CAMERA_YUV422});
+    while(!acquireCameraFrame())
+        Platform::sleep(1000000);
+    u16* texture = (u16*)Platform::textureData(arg->textures[Stereo::EYE_LEFT]);
+    convertCameraRows(Stereo::EYE_LEFT, 0, CAMERA_TILE_ROWS);
+    std::vector<u16> software(texture, texture + CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT);
+    bool unavailable = !convertCameraTexture(Stereo::EYE_LEFT);
+    Platform::setYuvConversion(true);
+    std::fill(texture, texture + software.size(), 0);
+    bool converted = convertCameraTexture(Stereo::EYE_LEFT);
+    bool same = std::equal(software.begin(), software.end(), texture);
+    closeCameraThread();
+    check(unavailable && converted && same, "Y2R and CPU conversions of a frame match");
+
+    const char* path = "test_yuv.bin";
+    writeSyntheticLog(path, 10, 5);
+    Platform::setYuvConversion(false);
+    ReplayResult cpu = replay(path);
+    Platform::setYuvConversion(true);
+    u32 before = Platform::yuvConversions();
+    ReplayResult y2r = replay(path);
+    bool used = Platform::yuvConversions() > before;
+    Platform::setYuvConversion(false);
+    check(used && cpu.checksum == y2r.checksum, "the game converts with Y2R when it can, without changing how it goes");
+    remove(path);
+}
+
+static void testTripleBuffer()
+{
+    u32 a = 0, b = 0, c = 0;
+    TripleBuffer<u32> frames(&a, &b, &c);
+    check(!frames.acquire(), "nothing to acquire before the first publish");
+    *frames.writeBuffer() = 1;
+    frames.publish();
+    *frames.writeBuffer() = 2;
+    frames.publish();
+    check(frames.acquire() && *frames.readBuffer() == 2 && frames.sequence() == 2, "acquire returns the newest frame");
+    check(!frames.acquire(), "a frame is only acquired once");
+
+    // A producer thread filling whole frames with their sequence number as fast as it can, against a consumer reading them
+    constexpr u32 SIZE = 256, FRAMES = 200000;
+    std::vector<u32> slots[3];
+    for(auto& slot : slots)
+        slot.assign(SIZE, 0);
+    TripleBuffer<u32> shared(slots[0].data(), slots[1].data(), slots[2].data());
+
+    std::atomic<bool> done(false);
+    std::thread producer([&]() {
+        for(u32 sequence = 1; sequence <= FRAMES; sequence++)
+        {
+            std::fill_n(shared.writeBuffer(), SIZE, sequence);
+            shared.publish();
+        }
+        done = true;
+    });
+
+    u32 acquired = 0, torn = 0, backwards = 0, last = 0;
+    for(;;)
+    {
+        // Whatever was published before done is still acquired once
+        bool finished = done;
+        if(!shared.acquire())
+        {
+            if(finished)
+                break;
+            continue;
+        }
+        const u32* frame = shared.readBuffer();
+        torn += std::any_of(frame, frame + SIZE, [&shared](u32 value) { return value != shared.sequence(); });
+        backwards += shared.sequence() <= last;
+        last = shared.sequence();
+        acquired++;
+    }
+    producer.join();
+    check(acquired > 0 && last == FRAMES, "the consumer ends on the last frame published");
+    check(torn == 0 && backwards == 0, "sequence numbers only go up and no frame is torn across threads");
+}
+
+// A producer standing in for both cameras, landing pictures straight in the ring while the consumer reads
+// Now and then a transfer fails halfway through a pair, which has to be dropped without tearing what's published
+static void testCaptureRing()
+{
+    constexpr u32 STRIDE = 64, CAMERAS = 2, FRAMES = 20000;
+    std::vector<u16> slots[3];
+    for(auto& slot : slots)
+        slot.assign(STRIDE*CAMERAS, 0);
+    TripleBuffer<u16> frames(slots[0].data(), slots[1].data(), slots[2].data());
+    CaptureRing ring(&frames, CAMERAS, STRIDE);
+
+    bool early = ring.received(0) == NULL && ring.pending();
+    ring.dropped();
+    check(early && !ring.pending() && !frames.acquire(), "a pair isn't published until both pictures landed");
+
+    std::atomic<bool> done(false);
+    u32 published = 0, drops = 0;
+    std::thread producer([&]() {
+        u32 state = 99;
+        for(u16 id = 1; published < FRAMES; id++)
+        {
+            for(u32 camera = 0; camera < CAMERAS; camera++)
+            {
+                std::fill_n(ring.target(camera), STRIDE, id);
+                state = state*1664525u + 1013904223u;
+                if(camera == 0 && (state >> 24) < 8)
+                {
+                    ring.dropped();
+                    drops++;
+                    break;
+                }
+                if(ring.received(camera) != NULL)
+                    published++;
+            }
+        }
+        done = true;
+    });
+
+    u32 acquired = 0, torn = 0, backwards = 0;
+    u16 last = 0;
+    for(;;)
+    {
+        // Whatever was published before done is still acquired once
+        bool finished = done;
+        if(!frames.acquire())
+        {
+            if(finished)
+                break;
+            continue;
+        }
+        const u16* frame = frames.readBuffer();
+        u16 id = frame[0];
+        torn += std::any_of(frame, frame + STRIDE*CAMERAS, [id](u16 value) { return value != id; });
+        backwards += id <= last;
+        last = id;
+        acquired++;
+    }
+    producer.join();
+    check(published == FRAMES && drops > 0 && acquired > 0, "the ring publishes every completed pair");
+    check(torn == 0 && backwards == 0, "frames from the ring are whole and in order");
+}
+
+static void testRandom()
+{
+    Random a(1234, Random::STREAM_SPAWN), b(1234, Random::STREAM_SPAWN), other(1234, 1), reseeded(99);
+    reseeded.seed(1234, Random::STREAM_SPAWN);
+    bool same = true, different = false;
+    for(u32 i = 0; i < 1000; i++)
+    {
+        u32 value = a.next();
+        same &= value == b.next() && value == reseeded.next();
+        different |= value != other.next();
+    }
+    check(same && different, "random streams repeat for a seed and differ between streams");
+
+    u32 counts[10] = {0};
+    bool inRange = true;
+    for(u32 i = 0; i < 100000; i++)
+    {
+        u32 value = a.below(10);
+        float unit = a.uniform();
+        inRange &= value < 10 && unit >= 0.0f && unit < 1.0f;
+        counts[std::min(value, 9u)]++;
+    }
+    check(inRange && *std::min_element(counts, counts + 10) > 9500 && *std::max_element(counts, counts + 10) < 10500, "random numbers stay in range and spread evenly");
+}
+
+static void testTimerWheel()
+{
+    // Events all over the levels and past them, each due exactly on its tick
+    TimerWheel wheel;
+    Random random(5);
+    std::vector<u64> times;
+    for(u32 i = 0; i < 5000; i++)
+    {
+        u64 time = 1 + (i < 4000 ? random.below(1u << (6 + random.below(18))) : TimerWheel::RANGE + random.below(TimerWheel::RANGE));
+        times.push_back(time);
+        wheel.schedule(time, 0, i);
+    }
+    std::vector<TimerWheel::Event> due;
+    bool onTime = true, ordered = true;
+    u64 now = 0;
+    while(wheel.pending() > 0)
+    {
+        u64 previous = now;
+        now += 1 + random.below(200);
+        due.clear();
+        wheel.advance(now, due);
+        for(u32 i = 0; i < due.size(); i++)
+        {
+            onTime &= due[i].time == times[due[i].argument] && due[i].time > previous && due[i].time <= now;
+            ordered &= i == 0 || due[i-1].time <= due[i].time;
+        }
+    }
+    check(onTime && ordered, "timer wheel fires every event on its tick, earliest first");
+
+    // Same tick events go in scheduling order, and late ones come out on the next advance
+    wheel.reset(100);
+    wheel.schedule(300, 0, 0);
+    wheel.schedule(164, 0, 1);
+    wheel.schedule(300, 0, 2);
+    wheel.schedule(50, 0, 3);
+    due.clear();
+    wheel.advance(100, due);
+    bool late = due.size() == 1 && due[0].argument == 3;
+    due.clear();
+    wheel.advance(400, due);
+    check(late && due.size() == 3 && due[0].argument == 1 && due[1].argument == 0 && due[2].argument == 2 && wheel.pending() == 0, "timer wheel keeps scheduling order within a tick");
+}
+
+static void testWaves()
+{
+    std::vector<Waves::Spawn> spawns;
+    bool parsed = Waves::parse("# a comment\n\n1.5 splash 10 -20\r\n  3 boss 0 0", spawns);
+    check(parsed && spawns.size() == 2 && spawns[0].seconds == 1.5f && spawns[0].tY == -20 && !spawns[0].boss && spawns[1].boss, "wave scripts are parsed");
+    check(!Waves::parse("2 dragon 0 0", spawns) && spawns.size() == 2, "a wave script that can't be read is left out");
+
+    // Thousands of scripted spawns, most of them long after the session ends
+    const char* script = "test_waves.txt";
+    FILE* file = fopen(script, "w");
+    for(u32 i = 0; i < 5000; i++)
+        fprintf(file, "%u.5 splash %d %d\n", 2 + i*i/100, (int)(i*37 % 360) - 180, (int)(i*11 % 180) - 90);
+    fclose(file);
+
+    const char* path = "test_waves.bin";
+    writeSyntheticLog(path, 20, 11);
+    ReplayResult plain = replay(path), scripted = replay(path, script), again = replay(path, script);
+    check(scripted.splashes > plain.splashes && scripted.checksum == again.checksum, "scripted waves spawn on time and replay the same");
+    remove(path);
+    remove(script);
+}
+
+static void testSplashPool()
+{
+    // Handles keep their slot in the low 20 bits, the slot's generation above
+    auto slotOf = [](SplashHandle handle) { return handle & ((1 << 20) - 1); };
+
+    SplashPool pool;
+    SplashHandle first = pool.add(1, 0, 0, 10, 0, 0);
+    SplashHandle middle = pool.add(2, 0, 0, 20, 0, 0);
+    SplashHandle last = pool.add(3, 0, 0, 30, 0, 0);
+    check(pool.remove(middle) && pool.indexOf(middle) == SplashPool::INVALID_INDEX && !pool.remove(middle), "a removed splash's handle goes stale");
+    check(pool.size() == 2 && pool.indexOf(last) == 1 && pool.anglesX()[pool.indexOf(last)] == 3 && pool.healths()[pool.indexOf(first)] == 10, "the last splash moved into the hole keeps its handle");
+    check(pool.handleAt(pool.indexOf(last)) == last && pool.indexOf(SplashPool::INVALID_HANDLE) == SplashPool::INVALID_INDEX, "indices and handles map back to each other");
+
+    SplashHandle reused = pool.add(4, 0, 0, 40, 0, 0);
+    check(slotOf(reused) == slotOf(middle) && reused != middle && pool.indexOf(middle) == SplashPool::INVALID_INDEX && pool.anglesX()[pool.indexOf(reused)] == 4, "a freed slot is reused under a new generation");
+
+    // Splashes coming and going at random, every live handle has to find its own and every removed one nothing
+    Random random(4);
+    std::vector<std::pair<SplashHandle, float>> live, dead;
+    pool.clear();
+    for(u32 i = 0; i < 20000; i++)
+    {
+        if(live.empty() || random.below(3) != 0)
+        {
+            float tX = i;
+            live.push_back({pool.add(tX, 0, 0, 1, 0, 0), tX});
+        }
+        else
+        {
+            u32 which = random.below(live.size());
+            pool.remove(live[which].first);
+            dead.push_back(live[which]);
+            live[which] = live.back();
+            live.pop_back();
+        }
+    }
+    bool found = pool.size() == live.size();
+    for(const auto& splash : live)
+        found = found && pool.indexOf(splash.first) != SplashPool::INVALID_INDEX && pool.anglesX()[pool.indexOf(splash.first)] == splash.second;
+    bool stale = true;
+    for(const auto& splash : dead)
+        stale = stale && pool.indexOf(splash.first) == SplashPool::INVALID_INDEX;
+    check(found && stale, "handles stay right through thousands of spawns and removals");
+}
+
+static void testDamage()
+{
+    // Every channel counts, red in the low byte like Platform::color32
+    DamageTable table;
+    table.setWater(0, Platform::color32(0x00, 0x94, 0xFF, 0xFF), 1, true);
+    table.setWater(1, Platform::color32(0xC0, 0x40, 0x40, 0xFF), 10);
+    check(table.damage(0, Platform::color32(0x20, 0x20, 0x20, 0xFF)) == 1 && table.damage(0, Platform::color32(0xDF, 0x80, 0x20, 0xFF)) == 1, "clear water hurts every color the same");
+    check(table.damage(1, Platform::color32(0xB0, 0x50, 0x40, 0xFF)) == 10 && table.damage(1, Platform::color32(0x40, 0x40, 0x40, 0xFF)) == 3 && table.damage(1, Platform::color32(0xC0, 0xC0, 0x40, 0xFF)) == 3, "water hurts paint of its own color the most");
+
+    bool matches = true;
+    Random random(3);
+    for(u32 i = 0; i < 10000; i++)
+    {
+        u32 paint = random.next(), water = random.next();
+        table.setWater(2, water, 5);
+        double modifier = 1;
+        for(u32 shift = 0; shift < 24; shift += 8)
+        {
+            int paintPart = (paint >> shift) & 0xFF, waterPart = (water >> shift) & 0xFF;
+            if(abs(paintPart - waterPart) > DamageTable::TOLERANCE)
+                modifier *= paintPart > waterPart ? (double)waterPart/paintPart : (double)paintPart/waterPart;
+        }
+        // Single and double precision only round differently right on a whole number
+        matches &= table.damage(2, paint) == (int)(5*modifier) || std::abs(5*modifier - std::round(5*modifier)) < 1e-4;
+    }
+    check(matches, "damage table matches the modifiers worked out one by one, and follows color changes");
+
+    // Two splashes and a boss in the beam, one splash out of it and one removed
+    SplashPool pool;
+    u32 white = Platform::color32(0xFF, 0xFF, 0xFF, 0xFF);
+    table.setWater(3, white, 5);
+    SplashHandle near = pool.add(2, 1, 0, 5, white, 0);
+    SplashHandle far = pool.add(-6, 6, 0, 50, white, 0);
+    SplashHandle boss = pool.add(14, 0, 0, 500, white, SplashPool::FLAG_BOSS);
+    SplashHandle outside = pool.add(12, 0, 0, 5, white, 0);
+    SplashHandle removed = pool.add(0, 0, 0, 5, white, 0);
+    pool.remove(removed);
+    std::vector<SplashHandle> candidates = {far, outside, removed, boss, near}, killed;
+
+    DamageTable::Beam beam = {0, 0, 8, 3, DamageTable::BEAM_FIRST_HIT};
+    int damage = table.hit(pool, beam, candidates, killed);
+    check(damage == 5 && killed.size() == 1 && killed[0] == near && pool.healths()[pool.indexOf(far)] == 50 && pool.size() == 4, "a first hit beam only hurts the splash nearest to the aim");
+
+    killed.clear();
+    pool.healths()[pool.indexOf(near)] = 5;
+    beam.mode = DamageTable::BEAM_PIERCE;
+    table.hit(pool, beam, candidates, killed);
+    check(killed.size() == 1 && pool.healths()[pool.indexOf(far)] == 45 && pool.healths()[pool.indexOf(boss)] == 495 && pool.healths()[pool.indexOf(outside)] == 5, "a piercing beam hurts every splash in its center, bosses' twice as big");
+
+    killed.clear();
+    beam.tX = beam.tY = 180;
+    check(table.hit(pool, beam, candidates, killed) == -1 && killed.empty(), "a beam that hits nothing says so");
+}
+
+static u32 memoryFailures = 0;
+static Memory::Tag lastFailedTag;
+
+static void countMemoryFailure(Memory::Tag tag, size_t needed, size_t budget)
+{
+    (void)needed;
+    (void)budget;
+    memoryFailures++;
+    lastFailedTag = tag;
+}
+
+static void testMemory()
+{
+    Memory::setFailureHandler(countMemoryFailure);
+
+    // TAG_FRAME is only used by arenas, none of which is alive here
+    size_t budget = Memory::info(Memory::TAG_FRAME).budget;
+    size_t heap = Memory::regionUsed(Memory::REGION_HEAP);
+    Memory::resetPeaks();
+    Memory::account(Memory::TAG_FRAME, 1000);
+    Memory::account(Memory::TAG_FRAME, 500);
+    Memory::release(Memory::TAG_FRAME, 1000);
+    check(Memory::used(Memory::TAG_FRAME) == 500 && Memory::peak(Memory::TAG_FRAME) == 1500 && Memory::regionUsed(Memory::REGION_HEAP) == heap + 500, "memory is counted per tag and region, with its peak");
+
+    Memory::setBudget(Memory::TAG_FRAME, 1000);
+    Memory::account(Memory::TAG_FRAME, 600);
+    check(memoryFailures == 1 && lastFailedTag == Memory::TAG_FRAME, "going over a budget is reported");
+    Memory::release(Memory::TAG_FRAME, 1100);
+    Memory::setBudget(Memory::TAG_FRAME, budget);
+    memoryFailures = 0;
+
+    {
+        FrameArena arena(1024);
+        u8* first = arena.allocate<u8>(3);
+        double* second = arena.allocate<double>(4);
+        u32* third = arena.allocate<u32>(1);
+        bool aligned = ((uintptr_t)second % alignof(double)) == 0 && (u8*)second >= first + 3 && (u8*)third >= (u8*)(second + 4);
+        check(aligned && Memory::used(Memory::TAG_FRAME) == 1024, "frame arena hands out aligned memory one after the other");
+
+        size_t used = arena.used();
+        arena.reset();
+        check(arena.used() == 0 && arena.peak() == used && arena.allocate<u8>(1) == first, "frame arena starts over on reset");
+
+        check(arena.allocate<u8>(2000) == NULL && memoryFailures == 1 && lastFailedTag == Memory::TAG_FRAME, "frame arena reports running out");
+        memoryFailures = 0;
+        arena.reset();
+
+        // Threads allocating at once each get their own memory
+        constexpr u32 THREADS = 4, EACH = 32;
+        std::vector<u32*> pointers(THREADS*EACH);
+        std::vector<std::thread> threads;
+        for(u32 t = 0; t < THREADS; t++)
+            threads.emplace_back([&, t]() {
+                for(u32 i = 0; i < EACH; i++)
+                {
+                    pointers[t*EACH + i] = arena.allocate<u32>(2);
+                    pointers[t*EACH + i][0] = pointers[t*EACH + i][1] = t*EACH + i;
+                }
+            });
+        for(auto& thread : threads)
+            thread.join();
+        bool disjoint = arena.used() == THREADS*EACH*8;
+        for(u32 i = 0; i < THREADS*EACH; i++)
+            disjoint &= pointers[i][0] == i && pointers[i][1] == i;
+        check(disjoint, "frame arena can be allocated from by several threads");
+    }
+    check(Memory::used(Memory::TAG_FRAME) == 0, "frame arena gives its memory back");
+
+    {
+        struct Counted
+        {
+            Counted(int* alive) : alive(alive) { (*alive)++; }
+            ~Counted() { (*alive)--; }
+            int* alive;
+        };
+        int alive = 0;
+        ObjectPool<Counted, 4> pool(Memory::TAG_FRAME);
+        Counted* objects[4];
+        for(auto& object : objects)
+            object = pool.create(&alive);
+        check(alive == 4 && pool.used() == 4 && pool.create(&alive) == NULL && memoryFailures == 1, "object pool holds a fixed number of objects");
+        memoryFailures = 0;
+
+        pool.destroy(objects[2]);
+        pool.destroy(objects[0]);
+        Counted* reused = pool.create(&alive);
+        check(alive == 3 && pool.used() == 3 && pool.peak() == 4 && reused == objects[0], "object pool reuses destroyed slots");
+        pool.destroy(reused);
+        pool.destroy(objects[1]);
+        pool.destroy(objects[3]);
+        check(alive == 0 && Memory::used(Memory::TAG_FRAME) == sizeof(pool), "object pool storage is counted once");
+    }
+
+    // A whole session only keeps what lives as long as the program, like the text pool
+    size_t before[Memory::TAG_AMOUNT];
+    for(u32 tag = 0; tag < Memory::TAG_AMOUNT; tag++)
+        before[tag] = Memory::used((Memory::Tag)tag);
+    Memory::resetPeaks();
+    const char* path = "test_memory.bin";
+    writeSyntheticLog(path, 20, 3, true);
+    replay(path);
+    remove(path);
+    bool returned = true, underBudget = true;
+    for(u32 tag = 0; tag < Memory::TAG_AMOUNT; tag++)
+    {
+        returned &= Memory::used((Memory::Tag)tag) == before[tag];
+        underBudget &= Memory::peak((Memory::Tag)tag) <= Memory::info((Memory::Tag)tag).budget;
+    }
+    check(returned && underBudget && memoryFailures == 0, "a session gives back all its memory and stays within budget");
+    check(Memory::peak(Memory::TAG_CAMERA_FRAMES) > 0 && Memory::peak(Memory::TAG_TEXTURES) > 0 && Memory::peak(Memory::TAG_GAME) > 0 && Memory::peak(Memory::TAG_FRAME) > 0, "camera frames, textures and the game are counted");
+
+    Memory::setFailureHandler(NULL);
+}
+
+// The most each FAST_MATH_BACKEND may be off from double, sin and cos as values and atan2 in degrees
+typedef struct
+{
+    const char* name;
+    float (*sine)(float degrees);
+    float (*arctangent)(float y, float x);
+    double sineError, arctangentError;
+} MathBackend;
+
+static const MathBackend MATH_BACKENDS[] = {
+    {"libm", FastMath::Libm::sinDegrees, FastMath::Libm::atan2Degrees, 1e-5, 1e-4},
+    {"LUT", FastMath::Lut::sinDegrees, FastMath::Lut::atan2Degrees, 1e-4, 2e-4},
+    {"Q16", FastMath::Fixed::sinDegrees, FastMath::Fixed::atan2Degrees, 2e-4, 2e-4},
+};
+
+static double wrapReference(double degrees)
+{
+    double wrapped = std::fmod(degrees + 180.0, 360.0);
+    return (wrapped < 0 ? wrapped + 360.0 : wrapped) - 180.0;
+}
+
+static void testFastMath()
+{
+    constexpr double RADIANS_PER_DEGREE = 3.14159265358979323846/180;
+    char what[96];
+    for(const MathBackend& backend : MATH_BACKENDS)
+    {
+        // Two turns either way in hundredths of a degree, cos being sin a quarter turn on like cosDegrees does it
+        double sineError = 0, cosineError = 0;
+        for(s32 i = -72000; i <= 72000; i++)
+        {
+            float degrees = i*0.01f;
+            sineError = std::max(sineError, std::abs(backend.sine(degrees) - std::sin(degrees*RADIANS_PER_DEGREE)));
+            cosineError = std::max(cosineError, std::abs(backend.sine(degrees + 90.0f) - std::cos(degrees*RADIANS_PER_DEGREE)));
+        }
+        snprintf(what, sizeof(what), "%s sin and cos within %g of double", backend.name, backend.sineError);
+        check(sineError <= backend.sineError && cosineError <= backend.sineError, what);
+
+        // A full turn on circles small and big, compared round the circle so that -180 and 180 are the same
+        double arctangentError = 0;
+        for(float radius : {1e-3f, 1.0f, 1e3f})
+        {
+            for(s32 i = -18000; i < 18000; i++)
+            {
+                double angle = i*0.01*RADIANS_PER_DEGREE;
+                float y = radius*std::sin(angle), x = radius*std::cos(angle);
+                double expected = std::atan2((double)y, (double)x)/RADIANS_PER_DEGREE;
+                arctangentError = std::max(arctangentError, std::abs(wrapReference(backend.arctangent(y, x) - expected)));
+            }
+        }
+        snprintf(what, sizeof(what), "%s atan2 within %g degrees of double", backend.name, backend.arctangentError);
+        check(arctangentError <= backend.arctangentError && backend.arctangent(0, 0) == 0, what);
+    }
+
+    double wrapError = 0;
+    bool inRange = true;
+    for(s32 i = -1000000; i <= 1000000; i++)
+    {
+        float degrees = i*0.0137f;
+        float wrapped = FastMath::wrapDegrees(degrees);
+        inRange = inRange && wrapped >= -180.0f && wrapped < 180.0f;
+        wrapError = std::max(wrapError, std::abs(wrapReference(wrapped - wrapReference(degrees))));
+    }
+    check(inRange && wrapError <= 1e-3, "wrapDegrees stays in [-180, 180) within 1e-3 degrees of double");
+}
+
+// Every query has to give what looking at every item would, on both sides of the +-180 degree seam
+static void testAngularGrid()
+{
+    Random random(11);
+    std::vector<std::pair<float, float>> points;
+    for(u32 i = 0; i < 2000; i++)
+        points.push_back({random.uniform()*360 - 180, random.uniform()*360 - 180});
+    for(float seam : {-180.0f, -179.99f, 179.99f, 180.0f})
+    {
+        points.push_back({seam, random.uniform()*360 - 180});
+        points.push_back({random.uniform()*360 - 180, seam});
+        points.push_back({seam, -seam});
+    }
+
+    AngularGrid<u32> grid;
+    std::vector<bool> inGrid(points.size(), true);
+    for(u32 i = 0; i < points.size(); i++)
+        grid.insert(i, points[i].first, points[i].second);
+
+    std::vector<u32> found, expected;
+    auto matches = [&](float tX, float tY, float radius) {
+        grid.query(tX, tY, radius, found);
+        expected.clear();
+        for(u32 i = 0; i < points.size(); i++)
+            if(inGrid[i] && std::abs(angleDelta(points[i].first, tX)) <= radius && std::abs(angleDelta(points[i].second, tY)) <= radius)
+                expected.push_back(i);
+        std::sort(found.begin(), found.end());
+        return found == expected;
+    };
+
+    const float RADII[] = {0.5f, 8.0f, 16.0f, 67.5f, 179.0f, 200.0f};
+    const float SEAM[] = {-180.0f, -179.5f, 0.0f, 179.5f, 180.0f};
+    bool anywhere = true, acrossSeam = true;
+    for(u32 i = 0; i < 500; i++)
+        anywhere = matches(random.uniform()*360 - 180, random.uniform()*360 - 180, RADII[random.below(6)]) && anywhere;
+    for(float tX : SEAM)
+        for(float tY : SEAM)
+            for(float radius : RADII)
+                acrossSeam = matches(tX, tY, radius) && acrossSeam;
+    check(anywhere, "grid queries find what a scan of every splash does");
+    check(acrossSeam, "grid queries across the +-180 degree seam find what a scan does");
+
+    // Taking every other item out leaves the grid answering for the rest
+    bool removed = true;
+    for(u32 i = 0; i < points.size(); i += 2)
+    {
+        removed = grid.remove(i, points[i].first, points[i].second) && removed;
+        inGrid[i] = false;
+    }
+    bool remaining = grid.size() == points.size()/2;
+    for(float tX : SEAM)
+        for(float radius : RADII)
+            remaining = matches(tX, -tX, radius) && remaining;
+    check(removed && remaining, "grid removal leaves the other splashes found");
+}
+
+static void testOrientation()
+{
+    constexpr u64 TPS = Platform::TICKS_PER_SECOND;
+    Orientation orientation(TPS);
+    float angle = 0;
+    u64 tick = 0;
+    // 60 degrees of pitch in 3 seconds at an uneven rate, then a minute of standing still
+    for(u32 i = 0; i < 3600; i++)
+    {
+        tick += TPS/60 + (i % 3)*TPS/1000;
+        float rate = i < 180 ? 20.0f*(TPS/60 + (i % 3)*TPS/1000)/(TPS/60.0f) : 0.0f;
+        angle += rate/60;
+        float radians = angle*FastMath::PI/180;
+        Orientation::Sample sample = {tick, {rate, 0, 0}, {0, std::sin(radians), std::cos(radians)}};
+        orientation.update(sample);
+    }
+    check(std::abs(orientation.pitch() - angle) < 0.5f && std::abs(orientation.roll()) < 0.5f, "orientation follows a pitch rotation");
+
+    // Tilted while the gyroscope wasn't looking, gravity pulls the attitude back as fast at 15 samples a second as at 120
+    auto settle = [](u32 rate) {
+        Orientation orientation(TPS);
+        orientation.substep = 1.0f/120;
+        orientation.update({1, {0, 0, 0}, {0, 0, 1}});
+        for(u32 i = 1; i <= rate; i++)
+            orientation.update({1 + i*TPS/rate, {0, 0, 0}, {0, 0.5f, 0.866f}});
+        return orientation.pitch();
+    };
+    float slow = settle(15), fast = settle(120);
+    check(fast > 5 && fast < 29 && std::abs(slow - fast) < 0.05f, "orientation settles the same at any sample rate");
+
+    // A minute lying flat with the gyroscope biased 0.5 degrees a second on every axis: gravity keeps pitch and roll within
+    // bias/proportionalGain while the bias estimate catches up, then brings them back, nothing holds yaw so it's only reported
+    Orientation biased(TPS);
+    float worstPitch = 0, worstRoll = 0;
+    for(u32 i = 1; i <= 60*60; i++)
+    {
+        biased.update({i*TPS/60, {0.5f, 0.5f, 0.5f}, {0, 0, 1}});
+        worstPitch = std::max(worstPitch, std::abs(biased.pitch()));
+        worstRoll = std::max(worstRoll, std::abs(biased.roll()));
+    }
+    check(worstPitch < 1.0f && worstRoll < 1.0f, "a biased gyroscope only moves pitch and roll a little");
+    check(std::abs(biased.pitch()) < 0.35f && std::abs(biased.roll()) < 0.35f, "the bias estimate brings pitch and roll back within a minute");
+    printf("yaw drift with that bias: %.1f degrees a minute\n", std::abs(biased.yaw()));
+}
+
+// Grey value noise with features a few pixels across, seen through a window moved by (offsetX, offsetY), packed like camera frames
+static void syntheticView(u16* frame, int offsetX, int offsetY, int width = CAMERA_BUFFER_WIDTH, int height = CAMERA_BUFFER_HEIGHT)
+{
+    auto noise = [](int x, int y) { u32 hash = (u32)x*73856093u ^ (u32)y*19349663u; hash ^= hash >> 13; hash *= 0x5bd1e995u; return (hash >> 24) & 0x3F; };
+    for(int y = 0; y < height; y++)
+        for(int x = 0; x < width; x++)
+        {
+            int worldX = x + offsetX, worldY = y + offsetY;
+            u32 value = noise(worldX >> 3, worldY >> 3);
+            frame[y*width + x] = (value >> 1) << 11 | value << 5 | (value >> 1);
+        }
+}
+
+static void testOpticalFlow()
+{
+    std::vector<u16> frame(CAMERA_BUFFER_SIZE);
+    OpticalFlow flow;
+    float shiftX = 0, shiftY = 0;
+    syntheticView(frame.data(), 1000, 1000);
+    check(!flow.update(frame.data(), &shiftX, &shiftY), "optical flow needs two frames");
+
+    // Moving the window left and up moves the picture right and down
+    syntheticView(frame.data(), 1000 - 12, 1000 + 8);
+    check(flow.update(frame.data(), &shiftX, &shiftY) && shiftX == 12 && shiftY == -8, "optical flow finds a shifted picture");
+    syntheticView(frame.data(), 1000 - 12, 1000 + 8);
+    check(flow.update(frame.data(), &shiftX, &shiftY) && shiftX == 0 && shiftY == 0, "optical flow finds a still picture");
+
+    std::fill(frame.begin(), frame.end(), 0x8410);
+    check(!flow.update(frame.data(), &shiftX, &shiftY), "optical flow gives up on a flat picture");
+
+    // A 160x120 picture, with the rest of the buffer changing for no reason
+    auto smallView = [&frame](int offsetX, int offsetY, u16 junk) {
+        syntheticView(frame.data(), offsetX, offsetY, 160, 120);
+        for(u32 i = 160*120; i < CAMERA_BUFFER_SIZE; i++)
+            frame[i] = junk*i;
+    };
+    flow.setArea(160, 120);
+    smallView(500, 500, 1);
+    flow.update(frame.data(), &shiftX, &shiftY);
+    smallView(500 + 8, 500 + 4, 7);
+    check(flow.update(frame.data(), &shiftX, &shiftY) && shiftX == -8 && shiftY == -4, "optical flow only looks at the picture's area");
+}
+
+static void testPalette()
+{
+    constexpr u16 RED = 0xF800, BLUE = 0x001F, GREEN = 0x07E0;
+    std::vector<u16> frame(CAMERA_BUFFER_SIZE);
+    // Red on the top two thirds, blue below
+    for(u32 y = 0; y < CAMERA_BUFFER_HEIGHT; y++)
+        std::fill_n(&frame[y*CAMERA_BUFFER_WIDTH], CAMERA_BUFFER_WIDTH, y < CAMERA_BUFFER_HEIGHT*2/3 ? RED : BLUE);
+
+    Palette palette;
+    u32 colors[3];
+    check(palette.topColors(colors, 3) == 0, "palette starts empty");
+    for(u32 i = 0; i < Palette::TILE_COUNT/palette.tilesPerFrame + 1; i++)
+        palette.update(frame.data());
+    check(palette.topColors(colors, 3) == 2 && colors[0] == Platform::color32(0xFF, 0, 0, 0xFF) && colors[1] == Platform::color32(0, 0, 0xFF, 0xFF), "palette finds the dominant colors in order");
+
+    std::fill(frame.begin(), frame.end(), GREEN);
+    for(u32 i = 0; i < 90; i++)
+        palette.update(frame.data());
+    check(palette.topColors(colors, 1) == 1 && colors[0] == Platform::color32(0, 0xFF, 0, 0xFF), "palette follows a new picture");
+
+    // Only the first 160x120 pixels are the picture, the rest is left over from bigger ones
+    for(u32 i = 0; i < CAMERA_BUFFER_SIZE; i++)
+        frame[i] = i < 160*120 ? BLUE : RED;
+    palette.reset();
+    palette.setArea(160, 120);
+    for(u32 i = 0; i < 10; i++)
+        palette.update(frame.data());
+    check(palette.topColors(colors, 3) == 1 && colors[0] == Platform::color32(0, 0, 0xFF, 0xFF), "palette only looks at the picture's area");
+
+    // YUV422 tiles are averaged before being converted, like the Y2R unit would a pixel of that color
+    for(u32 i = 0; i < frame.size(); i++)
+        frame[i] = i % 2 ? 60 | 200 << 8 : 40 | 90 << 8;
+    palette.reset();
+    palette.setArea(CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_YUV422);
+    palette.update(frame.data());
+    u8 r, g, b;
+    Yuv::toRgb(50, 90, 200, &r, &g, &b);
+    check(palette.topColors(colors, 3) == 1 && colors[0] == Platform::color32(r, g, b, 0xFF), "palette reads YUV422 frames");
+}
+
+static void testPanorama()
+{
+    constexpr u16 RED = 0xF800;
+    constexpr u64 ALL_TILES = Panorama::TILE_COUNT == 64 ? ~0ull : (1ull << Panorama::TILE_COUNT) - 1;
+    auto at = [](const Panorama* panorama, float tX, float tY) { return panorama->pixels()[(u32)Panorama::row(tX)*Panorama::SIZE + (u32)Panorama::column(tY)]; };
+    std::vector<u16> frame(CAMERA_BUFFER_SIZE, RED), texture(Panorama::SIZE*Panorama::SIZE), expected(texture.size());
+
+    Panorama* panorama = new Panorama;
+    check(panorama->dirtyTiles() == ALL_TILES && panorama->seenTiles() == 0 && panorama->upload(texture.data()) == Panorama::TILE_COUNT && panorama->dirtyTiles() == 0,
+        "panorama starts unseen, with every tile to clear");
+
+    // Looking straight ahead covers the half turn in front on both axes, a quarter of the tiles
+    u32 stitched = panorama->stitch(frame.data(), CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_RGB565, 0, 0, UINT64_MAX);
+    check(stitched == Panorama::TILE_COUNT/4 && __builtin_popcountll(panorama->seenTiles()) == (int)stitched && panorama->dirtyTiles() == panorama->seenTiles(),
+        "panorama only stitches the tiles a frame covers");
+    check(at(panorama, 0, 0) == RED && at(panorama, 0, 180) == 0 && at(panorama, 180, 0) == 0, "panorama keeps what is behind untouched");
+
+    panorama->upload(texture.data());
+    Swizzle::convertFrame<Swizzle::FORMAT_RGB565, Panorama::SIZE, Panorama::SIZE, Panorama::SIZE>(panorama->pixels(), expected.data());
+    check(texture == expected && panorama->dirtyTiles() == 0, "panorama uploads its dirty tiles as a tiled texture");
+
+    // Frames are placed like the game draws splashes, 30 degrees to the side being three quarters of the way across
+    for(u32 y = 0; y < CAMERA_BUFFER_HEIGHT; y++)
+        for(u32 x = 0; x < CAMERA_BUFFER_WIDTH; x++)
+            frame[y*CAMERA_BUFFER_WIDTH + x] = x;
+    panorama->stitch(frame.data(), CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_RGB565, 0, 30, UINT64_MAX);
+    check(std::abs(at(panorama, 0, 60) - 300) <= 3 && std::abs(at(panorama, 0, 0) - 100) <= 3, "panorama places frames across like the game");
+    for(u32 y = 0; y < CAMERA_BUFFER_HEIGHT; y++)
+        std::fill_n(&frame[y*CAMERA_BUFFER_WIDTH], CAMERA_BUFFER_WIDTH, y);
+    panorama->stitch(frame.data(), CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_RGB565, 20, 0, UINT64_MAX);
+    check(std::abs(at(panorama, 50, 0) - 180) <= 2 && std::abs(at(panorama, 20, 0) - 120) <= 2, "panorama places frames down like the game");
+
+    // Smaller pictures are scaled to the screen's width like the camera image
+    std::fill(frame.begin(), frame.end(), 0);
+    frame[60*160 + 80] = RED;
+    panorama->reset();
+    panorama->stitch(frame.data(), 160, 120, Platform::CAMERA_RGB565, 0, 0, UINT64_MAX);
+    check(at(panorama, 0, 0) == RED, "panorama reads smaller pictures");
+
+    // Each pair of YUV422 pixels shares its U and V
+    for(u32 i = 0; i < frame.size(); i++)
+        frame[i] = i % 2 ? 100 | 200 << 8 : 100 | 64 << 8;
+    panorama->stitch(frame.data(), CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_YUV422, 0, 0, UINT64_MAX);
+    check(at(panorama, 0, 0) == Yuv::toRgb565(100, 64, 200), "panorama reads YUV422 frames");
+
+    // Without any time to spare a tile still goes in per frame, going round the covered ones
+    panorama->reset();
+    bool single = true;
+    for(u32 i = 0; i < Panorama::TILE_COUNT/4; i++)
+        single &= panorama->stitch(frame.data(), CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_YUV422, 0, 0, 0) == 1;
+    check(single && __builtin_popcountll(panorama->seenTiles()) == Panorama::TILE_COUNT/4, "panorama spreads tiles over frames when out of time");
+    delete panorama;
+}
+
+static void testDecals()
+{
+    constexpr u32 RED = Platform::color32(0xFF, 0, 0, 0xFF), BLUE = Platform::color32(0, 0, 0xFF, 0xFF);
+    std::vector<u32> texture(DecalLayer::SIZE*DecalLayer::SIZE, 0xDEADBEEF);
+    DecalLayer* layer = new DecalLayer(texture.data());
+    auto at = [layer](float tX, float tY) { return layer->texel(DecalLayer::column(tY), DecalLayer::row(tX)); };
+    check(std::all_of(texture.begin(), texture.end(), [](u32 texel) { return texel == 0; }) && layer->dirtyCount() == 0, "decal layer starts clear");
+
+    // About 3 texels around the middle, which sits on a corner between four tiles
+    layer->add({0, 0, 4.0f, RED});
+    constexpr u32 MIDDLE = DecalLayer::TILES/2;
+    check(layer->dirtyCount() == 4 && layer->dirty(MIDDLE - 1, MIDDLE - 1) && layer->dirty(MIDDLE, MIDDLE) && !layer->dirty(MIDDLE + 1, MIDDLE), "decals only dirty the tiles they touch");
+    std::vector<u32> before = texture;
+    check(layer->blend() == 4 && layer->dirtyCount() == 0 && layer->pending() == 0, "blending cleans the dirty tiles");
+    check(at(0, 0) == 0xFF0000FF && at(0, 10) == 0 && at(10, 0) == 0, "decals paint around their center");
+    u32 changed = 0, outside = 0;
+    for(u32 i = 0; i < texture.size(); i++)
+    {
+        if(texture[i] == before[i])
+            continue;
+        changed++;
+        u32 tile = i/Swizzle::TILE_PIXELS;
+        if(tile % DecalLayer::TILES < MIDDLE - 1 || tile % DecalLayer::TILES > MIDDLE || tile / DecalLayer::TILES < MIDDLE - 1 || tile / DecalLayer::TILES > MIDDLE)
+            outside++;
+    }
+    check(changed > 0 && outside == 0, "decals only write their own tiles");
+
+    bool soft = false;
+    for(u32 x = 0; x < DecalLayer::SIZE; x++)
+    {
+        u32 alpha = layer->texel(x, DecalLayer::SIZE/2) & 0xFF;
+        soft |= alpha > 0 && alpha < 0xFF;
+    }
+    check(soft, "decals fade out at their edge");
+
+    // Later decals go over earlier ones, in the same frame or not
+    layer->add({0, 0, 2.0f, BLUE});
+    layer->add({0, 0, 2.0f, RED});
+    layer->blend();
+    check(at(0, 0) == 0xFF0000FF, "decals of a frame are blended in order");
+    layer->add({0, 0, 2.0f, BLUE});
+    layer->blend();
+    check(at(0, 0) == 0x0000FFFF, "decals go over the paint already down");
+
+    // Half see-through paint over nothing keeps its color, only its alpha shows it
+    layer->add({90, 90, 4.0f, (RED & 0x00FFFFFF) | 0x80000000});
+    layer->blend();
+    check(at(90, 90) == 0xFF000080, "decal colors aren't darkened by their alpha");
+
+    // Across the +-180 seam, on both sides of the texture
+    layer->add({0, 179.5f, 4.0f, RED});
+    check(layer->dirty(0, MIDDLE) && layer->dirty(DecalLayer::TILES - 1, MIDDLE), "decals wrap around the texture's edge");
+    layer->blend();
+    check(at(0, 179.5f) == 0xFF0000FF && at(0, -179.5f) == 0xFF0000FF, "decals paint across the edge");
+
+    // However much paint is down, a frame only blends the tiles its new decals touch
+    for(u32 i = 0; i < 1000; i++)
+        layer->add({(float)(i % 360) - 180, (float)(i*7 % 360) - 180, 4.0f, RED});
+    layer->blend();
+    layer->add({45, 45, 1.0f, BLUE});
+    check(layer->blend() <= 4, "blending doesn't depend on how many decals came before");
+
+    for(u32 i = 0; i <= DecalLayer::MAX_PENDING; i++)
+        layer->add({0, 0, 1.0f, RED});
+    check(layer->pending() == 1, "a full queue is blended to make room");
+    delete layer;
+}
+
+static void testVisualCorrection()
+{
+    // Standing upright, gravity along y, with the gyroscope wrongly reporting a turn around y that gravity can't reveal
+    constexpr u64 TPS = Platform::TICKS_PER_SECOND;
+    Orientation corrected(TPS), uncorrected(TPS);
+    for(u32 i = 0; i < 60*60; i++)
+    {
+        Orientation::Sample sample = {1 + i*TPS/60, {0, 2.0f, 0}, {0, 1, 0}};
+        corrected.update(sample);
+        uncorrected.update(sample);
+        if(i % 2 == 1)
+            corrected.applyVisualRotation(0, 0);
+    }
+    check(std::abs(uncorrected.yaw()) > 30 && std::abs(corrected.yaw()) < 1, "camera corrections stop gyroscope drift around gravity");
+}
+
+static void testJobs()
+{
+    // Two layers of 16 jobs, each job of the second one waiting for two of the first
+    struct Task { std::atomic<u32>* counter; u32 seenBefore; volatile u32 spin; };
+    JobSystem jobs(3);
+    std::atomic<u32> counter(0);
+    Task tasks[32];
+    bool ordered = true, complete = true;
+    for(u32 round = 0; round < 100; round++)
+    {
+        counter = 0;
+        JobSystem::JobId ids[32];
+        for(u32 i = 0; i < 32; i++)
+        {
+            tasks[i] = {&counter, 0, 0};
+            ids[i] = jobs.add([](void* data) {
+                Task* task = (Task*)data;
+                for(u32 j = 0; j < 2000; j++)
+                    task->spin = task->spin + j;
+                task->seenBefore = task->counter->fetch_add(1);
+            }, &tasks[i]);
+        }
+        for(u32 i = 16; i < 32; i++)
+        {
+            jobs.depend(ids[i], ids[i - 16]);
+            jobs.depend(ids[i], ids[(i + 1) % 16]);
+        }
+        jobs.run();
+        complete &= counter == 32;
+        for(u32 i = 16; i < 32; i++)
+            ordered &= tasks[i].seenBefore > tasks[i - 16].seenBefore && tasks[i].seenBefore > tasks[(i + 1) % 16].seenBefore;
+    }
+    check(complete, "every job runs once");
+    check(ordered, "jobs run after what they depend on");
+
+    // The caller of run takes the newest job first, which waits for the oldest: that one can only run once a worker steals it,
+    // unless a worker stole the waiting one before
+    Platform::Semaphore taken;
+    u32 stolenBefore = jobs.stolenCount();
+    jobs.add([](void* data) { ((Platform::Semaphore*)data)->release(); }, &taken);
+    jobs.add([](void* data) { ((Platform::Semaphore*)data)->acquire(); }, &taken);
+    jobs.run();
+    check(jobs.stolenCount() > stolenBefore, "idle workers steal jobs");
+
+    // Past the limits, nothing is added and what was stays as it was
+    counter = 0;
+    bool added = true;
+    for(u32 i = 0; i < JobSystem::MAX_JOBS; i++)
+        added &= jobs.add([](void* data) { (*(std::atomic<u32>*)data)++; }, &counter) == i;
+    check(added && jobs.add([](void*) {}, NULL) == JobSystem::INVALID_JOB, "no more than MAX_JOBS jobs are added");
+    bool linked = true;
+    for(u32 i = 1; i <= JobSystem::MAX_DEPENDENTS; i++)
+        linked &= jobs.depend(i, 0);
+    check(linked && !jobs.depend(JobSystem::MAX_DEPENDENTS + 1, 0) && !jobs.depend(1, JobSystem::MAX_JOBS), "dependencies past the limits are refused");
+    jobs.run();
+    check(counter == JobSystem::MAX_JOBS, "a full graph still runs every job once");
+}
+
+static void testStartup()
+{
+    // A chain of three tasks next to two independent ones, after one run right away
+    struct Task { std::atomic<u32>* counter; u32 runs; volatile u32 spin; };
+    JobSystem jobs(3);
+    Startup startup;
+    std::atomic<u32> counter(0);
+    Task tasks[6];
+    auto work = [](void* data) {
+        Task* task = (Task*)data;
+        for(u32 j = 0; j < 100000; j++)
+            task->spin = task->spin + j;
+        task->runs++;
+        task->counter->fetch_add(1);
+    };
+    for(auto& task : tasks)
+        task = {&counter, 0, 0};
+
+    startup.runNow("first", work, &tasks[0]);
+    Startup::TaskId ids[5];
+    for(u32 i = 0; i < 5; i++)
+        ids[i] = startup.add("task", work, &tasks[i + 1]);
+    startup.depend(ids[1], ids[0]);
+    startup.depend(ids[2], ids[1]);
+    startup.depend(ids[2], 0);
+    startup.run(&jobs);
+
+    bool once = counter == 6;
+    for(auto& task : tasks)
+        once &= task.runs == 1;
+    check(once, "every startup task runs once");
+    check(startup.taskCount() == 6, "startup times every task");
+    check(startup.timing(ids[1]).start >= startup.timing(ids[0]).end && startup.timing(ids[2]).start >= startup.timing(ids[1]).end,
+        "startup tasks start after what they depend on ends");
+
+    bool timed = true;
+    for(u32 i = 0; i < startup.taskCount(); i++)
+        timed &= startup.timing(i).end > startup.timing(i).start;
+    check(timed, "startup tasks are timed");
+
+    check(!startup.reached(Startup::MILESTONE_FIRST_FRAME), "milestones start unreached");
+    startup.reach(Startup::MILESTONE_FIRST_FRAME);
+    u64 reachedAt = startup.milestone(Startup::MILESTONE_FIRST_FRAME);
+    Platform::sleep(1000000);
+    startup.reach(Startup::MILESTONE_FIRST_FRAME);
+    check(reachedAt != 0 && startup.milestone(Startup::MILESTONE_FIRST_FRAME) == reachedAt, "only the first time a milestone is reached counts");
+
+    // Past MAX_TASKS, nothing is added, but what has to run right away still does
+    Startup full;
+    counter = 0;
+    auto count = [](void* data) { (*(std::atomic<u32>*)data)++; };
+    bool added = true;
+    for(u32 i = 0; i < Startup::MAX_TASKS; i++)
+        added &= full.add("task", count, &counter) == i;
+    check(added && full.add("task", count, &counter) == Startup::INVALID_TASK, "no more than MAX_TASKS startup tasks are added");
+    full.runNow("late", count, &counter);
+    check(counter == 1 && full.taskCount() == Startup::MAX_TASKS, "a task run right away past MAX_TASKS still runs");
+    check(full.depend(1, 0) && !full.depend(Startup::MAX_TASKS, 0) && !full.depend(0, Startup::INVALID_TASK), "startup dependencies on unknown tasks are refused");
+    full.run(&jobs);
+    check(counter == Startup::MAX_TASKS + 1, "a full startup graph still runs every task once");
+}
+
+// Feeds frame times from cost(level, frame) and returns the level after each frame
+static std::vector<u32> governorTrace(CaptureGovernor& governor, u32 frames, std::function<double(u32 level, u32 frame)> cost)
+{
+    std::vector<u32> levels;
+    for(u32 i = 0; i < frames; i++)
+    {
+        governor.update(cost(governor.level(), i)*Platform::TICKS_PER_SECOND/1000);
+        levels.push_back(governor.level());
+    }
+    return levels;
+}
+
+static void testCaptureGovernor()
+{
+    constexpr double BUDGET = 1000.0/30; // in milliseconds, like the game's
+    CaptureGovernor governor(Platform::TICKS_PER_SECOND/30);
+    auto changes = [](const std::vector<u32>& levels) {
+        u32 count = 0;
+        for(u32 i = 1; i < levels.size(); i++)
+            count += levels[i] != levels[i-1];
+        return count;
+    };
+
+    auto levels = governorTrace(governor, 600, [](u32, u32) { return 20.0; });
+    check(changes(levels) == 0 && levels.back() == 0, "governor keeps the best level while frames fit");
+
+    // Every level costs 10ms less than the one above, only the last two fit
+    levels = governorTrace(governor, 600, [](u32 level, u32) { return 45.0 - 10*level; });
+    check(levels.back() == 2 && levels[governor.overrunLimit - 2] == 0 && levels[governor.overrunLimit - 1] == 1, "governor steps down until frames fit, once enough frames ran over");
+
+    // Between the headroom and the budget, nothing to gain by moving either way
+    levels = governorTrace(governor, 3000, [](u32, u32) { return BUDGET*0.8; });
+    check(changes(levels) == 0, "governor holds a level with frames between its headroom and the budget");
+
+    levels = governorTrace(governor, 3000, [](u32, u32) { return 5.0; });
+    check(levels.back() == 0 && changes(levels) == 2, "governor steps back up once there is room again");
+
+    // Level 0 runs over, level 1 has room to spare: it tries level 0 again less and less often
+    governor.reset();
+    levels = governorTrace(governor, 30*60*5, [](u32 level, u32) { return level == 0 ? 40.0 : 10.0; });
+    u32 firstHalf = changes(std::vector<u32>(levels.begin(), levels.begin() + levels.size()/2));
+    u32 secondHalf = changes(std::vector<u32>(levels.begin() + levels.size()/2, levels.end()));
+    check(changes(levels) <= 12 && secondHalf < firstHalf, "governor backs off from a level that can't hold");
+
+    // Single spikes, like a camera restart, don't count
+    governor.reset();
+    levels = governorTrace(governor, 900, [](u32, u32 frame) { return frame % 100 == 0 ? 80.0 : 15.0; });
+    check(changes(levels) == 0, "governor ignores isolated slow frames");
+
+    // A smaller capture converts its picture into the top left of the texture, drawn scaled to the screen's width
+    startCameraThread({160, 120, 15, 1, Platform::CAMERA_RGB565});
+    while(!acquireCameraFrame())
+        Platform::sleep(1000000);
+    u16* texture = (u16*)Platform::textureData(arg->textures[Stereo::EYE_LEFT]);
+    std::fill_n(texture, CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT, 0xDEAD);
+    convertCameraRows(Stereo::EYE_LEFT, 0, CAMERA_TILE_ROWS);
+    u32 untouched = std::count(texture, texture + CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT, 0xDEAD);
+    Platform::beginFrame();
+    Platform::drawTexture(arg->textures[Stereo::EYE_LEFT], 0, 0, 0.5f, 2.5f, 2.5f);
+    Platform::endFrame();
+    closeCameraThread();
+    check(untouched == CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT - 160*120, "a smaller capture only converts its own picture");
+    check(Platform::drawCommands()[0].width == 400 && Platform::drawCommands()[0].height == 300, "a smaller capture is drawn at its own size, scaled");
+}
+
+static void testRecording()
+{
+    const char* path = "test_recording.bin";
+    check(writeSyntheticLog(path, 2, 1234), "synthetic log written");
+    Recording::Reader reader;
+    check(reader.open(path) && reader.header().seed == 1234, "log header read back");
+    Recording::Frame frame;
+    u32 frames = 0;
+    while(reader.next(&frame))
+        frames++;
+    check(frames == 60, "every frame read back");
+    remove(path);
+}
+
+static void testReplay()
+{
+    const char* path = "test_replay.bin";
+    writeSyntheticLog(path, 120, 42);
+    ReplayResult first = replay(path), second = replay(path);
+    check(first.frames == 3600 && first.frames == second.frames, "replay runs every frame");
+    check(first.hitCounter == second.hitCounter && first.checksum == second.checksum, "replaying twice gives the same game");
+    check(first.splashes > 0, "splashes spawn during the synthetic session");
+    check(first.shown && second.shown, "startup reaches the first frame");
+    check(first.hitCounter > 0, "the synthetic session kills splashes");
+    remove(path);
+
+    // Stolen colors belong to the game they were stolen in
+    writeStealLog(path, false);
+    ReplayResult plain = replay(path);
+    writeStealLog(path, true);
+    ReplayResult stealing = replay(path);
+    writeStealLog(path, false);
+    ReplayResult after = replay(path);
+    check(plain.hitCounter == 0 && stealing.hitCounter > 0, "stolen water kills the splash it was taken from");
+    check(after.hitCounter == plain.hitCounter && after.checksum == plain.checksum, "a new game starts with the default waters");
+    remove(path);
+
+    // The same session drawn at another frame rate, or at an uneven one, runs the same steps
+    ReplayResult rates[3];
+    const u32 RATES[3] = {30, 60, 90};
+    for(u32 i = 0; i < 3; i++)
+    {
+        writeSteadyLog(path, 40, RATES[i]);
+        rates[i] = replay(path);
+    }
+    check(rates[0].hitCounter > 0, "the steady session kills splashes");
+    check(rates[1].hitCounter == rates[0].hitCounter && rates[2].hitCounter == rates[0].hitCounter && rates[1].checksum == rates[0].checksum && rates[2].checksum == rates[0].checksum, "the game goes as fast whatever the frame rate");
+
+    writeSteadyLog(path, 40, 30);
+    ReplayResult even = replay(path);
+    writeSteadyLog(path, 40, 30, true);
+    ReplayResult uneven = replay(path);
+    check(uneven.hitCounter == even.hitCounter && uneven.checksum == even.checksum, "uneven frames don't change the game");
+
+    // About 2 degrees a second, so tZ ends up 80 degrees away
+    writeSteadyLog(path, 40, 30, false, 30);
+    ReplayResult drifting = replay(path);
+    check(drifting.hitCounter == even.hitCounter && drifting.checksum == even.checksum, "splashes are still hit while the yaw drifts");
+    remove(path);
+}
+
+static void testProfiler()
+{
+    // Twice the ring's worth, so only the second half should count
+    for(u32 i = 0; i < Profiler::SAMPLE_COUNT*2; i++)
+        Profiler::record(Profiler::ZONE_OVERLAY, i < Profiler::SAMPLE_COUNT ? 1000000 : 100 + i % 100);
+    Profiler::Stats stats = Profiler::stats(Profiler::ZONE_OVERLAY);
+    check(stats.min == 100 && stats.p99 >= 195 && stats.p99 <= 199, "profiler min and p99 cover the last samples only");
+
+    u32 buckets[3];
+    Profiler::histogram(Profiler::ZONE_OVERLAY, 50, buckets, 3);
+    check(buckets[0] == 0 && buckets[2] + buckets[1] == Profiler::SAMPLE_COUNT, "profiler histogram puts every sample in a bucket");
+}
+
+static void testDrawList()
+{
+    Platform::Quad quads[] = {
+        {3, 0, 0, 0.8f, 0, 0, 1.0f, 0, false},
+        {Platform::NO_IMAGE, 0, 0, 0.7f, 10, 10, 1.0f, 0xFF0000FF, false},
+        {4, 0, 0, 0.6f, 0, 0, 1.0f, 0, false},
+    };
+    Platform::DrawList list = Platform::createDrawList(quads, 3);
+    Platform::beginFrame();
+    Platform::DrawStats stats = Platform::drawDrawList(list);
+    quads[2].depth = 0.9f;
+    Platform::setQuad(list, 2, quads[2]);
+    Platform::drawDrawList(list);
+    Platform::endFrame();
+
+    const auto& commands = Platform::drawCommands();
+    check(stats.vertices == 18 && stats.drawCalls == 1, "draw list counts its vertices and draw calls");
+    check(commands.size() == 6 && commands[0].type == Platform::DRAW_RECT && commands[1].image == 4 && commands[2].image == 3, "draw list is sorted by texture then depth");
+    check(commands[4].image == 3 && commands[5].image == 4 && commands[5].depth == 0.9f, "draw list is sorted again after a change");
+    Platform::deleteDrawList(list);
+}
+
+static void testStereo()
+{
+    float left = Stereo::eyeOffset(Stereo::EYE_LEFT, 1.0f, 1.0f), right = Stereo::eyeOffset(Stereo::EYE_RIGHT, 1.0f, 1.0f);
+    check(left > 0 && left == -right && left - right == Stereo::MAX_PARALLAX, "eyes move apart by the full parallax with the slider up");
+    check(Stereo::eyeOffset(Stereo::EYE_LEFT, 0.0f, 1.0f) == 0 && Stereo::eyeOffset(Stereo::EYE_RIGHT, 0.5f, 0.0f) == 0, "nothing moves in 2D or on the screen's plane");
+    check(Stereo::eyeOffset(Stereo::EYE_LEFT, 0.5f, 1.0f) == left/2 && Stereo::eyeOffset(Stereo::EYE_LEFT, 2.0f, 1.0f) == left, "parallax follows the slider up to its end");
+
+    Platform::Quad quads[] = {
+        {3, 10, 0, 0.5f, 0, 0, 1.0f, 0, false},
+        {3, 20, 0, 0.5f, 0, 0, 1.0f, 0, false},
+    };
+    Platform::DrawList list = Platform::createDrawList(NULL, 0);
+    Platform::setQuads(list, quads, 2);
+    Platform::beginFrame();
+    Platform::drawDrawList(list, 3.0f);
+    Platform::drawDrawList(list, -3.0f);
+    Platform::endFrame();
+    const auto& commands = Platform::drawCommands();
+    check(commands.size() == 4 && commands[0].x == 13 && commands[1].x == 23 && commands[2].x == 7 && commands[3].x == 17, "a draw list is drawn once per eye, moved apart");
+    Platform::deleteDrawList(list);
+
+    // Both eyes of a captured pair, converted in bands from every thread like the game does
+    startCameraThread({CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, 30, 2, Platform::CAMERA_RGB565});
+    while(!acquireCameraFrame())
+        Platform::sleep(1000000);
+    JobSystem jobs(2);
+    u32 bands[Stereo::EYE_AMOUNT][CAMERA_TILE_ROWS];
+    for(u32 eye = 0; eye < Stereo::EYE_AMOUNT; eye++)
+    {
+        for(u32 row = 0; row < CAMERA_TILE_ROWS; row++)
+        {
+            bands[eye][row] = eye << 16 | row;
+            jobs.add([](void* data) {
+                u32 band = *(u32*)data;
+                convertCameraRows((Stereo::Eye)(band >> 16), band & 0xFFFF, 1);
+            }, &bands[eye][row]);
+        }
+    }
+    jobs.run();
+
+    std::vector<u16> expected(CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT);
+    bool converted = true;
+    for(u32 eye = 0; eye < Stereo::EYE_AMOUNT; eye++)
+    {
+        Swizzle::convertFrame<Swizzle::FORMAT_RGB565, CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, CAMERA_TEXTURE_WIDTH>(arg->frames->readBuffer() + eye*CAMERA_BUFFER_SIZE, expected.data());
+        converted &= !memcmp(expected.data(), Platform::textureData(arg->textures[eye]), expected.size()*sizeof(u16));
+    }
+    bool different = memcmp(arg->frames->readBuffer(), arg->frames->readBuffer() + CAMERA_BUFFER_SIZE, CAMERA_BUFFER_SIZE_BYTES);
+    closeCameraThread();
+    check(converted && different, "each eye of a camera pair goes to its own texture");
+
+    // Switching to 3D mid game draws the right eye without changing how the game goes
+    const char* path = "test_stereo.bin";
+    writeSyntheticLog(path, 10, 7);
+    ReplayResult flat = replay(path);
+    writeSyntheticLog(path, 10, 7, true);
+    Platform::setStereoSlider(1.0f);
+    ReplayResult stereo = replay(path);
+    bool drewRight = std::any_of(Platform::drawCommands().begin(), Platform::drawCommands().end(), [](const Platform::DrawCommand& command) {
+        return command.screen == Platform::SCREEN_TOP_RIGHT;
+    });
+    Platform::setStereoSlider(0.0f);
+    check(Platform::stereoEnabled() && drewRight, "SELECT switches the top screen to 3D");
+    check(flat.checksum == stereo.checksum && flat.frames == stereo.frames, "3D doesn't change the game");
+    remove(path);
+}
+
+static void benchmark(const char* name, u32 iterations, double seconds)
+{
+    printf("%-32s %10.1f ns\n", name, seconds*1e9/iterations);
+}
+
+// Angles over two turns and points all round the circle, cycled through so every call is a different one
+template<float (*sine)(float degrees), float (*arctangent)(float y, float x)>
+static void benchmarkFastMath(const char* backend)
+{
+    constexpr u32 INPUTS = 4096, ITERATIONS = 10000000;
+    float degrees[INPUTS], ys[INPUTS], xs[INPUTS];
+    for(u32 i = 0; i < INPUTS; i++)
+    {
+        degrees[i] = i*720.0f/INPUTS - 360.0f;
+        ys[i] = std::sin(i*0.7f);
+        xs[i] = std::cos(i*0.7f);
+    }
+
+    char name[64];
+    volatile float sum = 0;
+    auto start = Clock::now();
+    for(u32 i = 0; i < ITERATIONS; i++)
+        sum += sine(degrees[i % INPUTS]);
+    snprintf(name, sizeof(name), "sinDegrees, %s", backend);
+    benchmark(name, ITERATIONS, secondsSince(start));
+
+    start = Clock::now();
+    for(u32 i = 0; i < ITERATIONS; i++)
+        sum += arctangent(ys[i % INPUTS], xs[i % INPUTS]);
+    snprintf(name, sizeof(name), "atan2Degrees, %s", backend);
+    benchmark(name, ITERATIONS, secondsSince(start));
+}
+
+static void runBenchmarks()
+{
+    {
+        std::vector<u16> src(CAMERA_BUFFER_SIZE), dst(CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT);
+        constexpr u32 ITERATIONS = 1000;
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            Swizzle::convertFrame<Swizzle::FORMAT_RGB565, CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, CAMERA_TEXTURE_WIDTH>(src.data(), dst.data());
+        benchmark("camera frame conversion", ITERATIONS, secondsSince(start));
+
+        start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            Yuv::convertTileRows<CAMERA_BUFFER_WIDTH, CAMERA_TEXTURE_WIDTH>(src.data(), dst.data(), 0, CAMERA_TILE_ROWS);
+        benchmark("camera frame conversion, YUV", ITERATIONS, secondsSince(start));
+    }
+
+    // Every backend, whichever one the game was built with
+    benchmarkFastMath<FastMath::Libm::sinDegrees, FastMath::Libm::atan2Degrees>("libm");
+    benchmarkFastMath<FastMath::Lut::sinDegrees, FastMath::Lut::atan2Degrees>("LUT");
+    benchmarkFastMath<FastMath::Fixed::sinDegrees, FastMath::Fixed::atan2Degrees>("Q16");
+
+    {
+        Orientation orientation(Platform::TICKS_PER_SECOND);
+        constexpr u32 ITERATIONS = 1000000;
+        Orientation::Sample sample = {0, {1, 2, 3}, {0.1f, 0.2f, 0.97f}};
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+        {
+            sample.tick += Platform::TICKS_PER_SECOND/1000;
+            orientation.update(sample);
+        }
+        benchmark("orientation update", ITERATIONS, secondsSince(start));
+    }
+
+    {
+        std::vector<u16> frames[2] = {std::vector<u16>(CAMERA_BUFFER_SIZE), std::vector<u16>(CAMERA_BUFFER_SIZE)};
+        syntheticView(frames[0].data(), 0, 0);
+        syntheticView(frames[1].data(), 4, 4);
+        OpticalFlow flow;
+        float shiftX, shiftY;
+        constexpr u32 ITERATIONS = 1000;
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            flow.update(frames[i & 1].data(), &shiftX, &shiftY);
+        benchmark("optical flow, scalar SAD", ITERATIONS, secondsSince(start));
+    }
+
+    {
+        // A window wandering over the synthetic picture, like a camera being moved around
+        constexpr u32 FRAMES = 64;
+        std::vector<u16> frames(CAMERA_BUFFER_SIZE*FRAMES);
+        for(u32 i = 0; i < FRAMES; i++)
+            syntheticView(&frames[i*CAMERA_BUFFER_SIZE], i*7, i*3);
+
+        Palette palette;
+        constexpr u32 ITERATIONS = 10000;
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            palette.update(&frames[(i % FRAMES)*CAMERA_BUFFER_SIZE]);
+        benchmark("palette update, 64 tiles", ITERATIONS, secondsSince(start));
+
+        u32 colors[CAMERA_PALETTE_COLORS];
+        start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            palette.topColors(colors, CAMERA_PALETTE_COLORS);
+        benchmark("palette top colors", ITERATIONS, secondsSince(start));
+
+        Panorama* panorama = new Panorama;
+        std::vector<u16> texture(Panorama::SIZE*Panorama::SIZE);
+        start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS/10; i++)
+        {
+            panorama->stitch(&frames[(i % FRAMES)*CAMERA_BUFFER_SIZE], CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT, Platform::CAMERA_RGB565, 0, i % 360, UINT64_MAX);
+            panorama->upload(texture.data());
+        }
+        benchmark("panorama stitch and upload", ITERATIONS/10, secondsSince(start));
+        delete panorama;
+    }
+
+    {
+        // A frame's worth of new decals over a session's worth already down
+        std::vector<u32> texture(DecalLayer::SIZE*DecalLayer::SIZE);
+        DecalLayer* layer = new DecalLayer(texture.data());
+        Random random(3);
+        auto decal = [&random]() { return DecalLayer::Decal{(float)random.below(360) - 180, (float)random.below(360) - 180, 4.0f, 0xFF0000FF}; };
+        for(u32 i = 0; i < 10000; i++)
+            layer->add(decal());
+        layer->blend();
+
+        constexpr u32 ITERATIONS = 10000;
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+        {
+            for(u32 j = 0; j < 4; j++)
+                layer->add(decal());
+            layer->blend();
+        }
+        benchmark("decal blend, 4 per frame", ITERATIONS, secondsSince(start));
+        delete layer;
+    }
+
+    {
+        // The camera conversion split into bands like in Game::runFrameJobs, as more threads join in, for one eye then a 3D pair
+        std::vector<u16> src(CAMERA_BUFFER_SIZE*Stereo::EYE_AMOUNT), dst(CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT*Stereo::EYE_AMOUNT);
+        struct Band { const u16* src; u16* dst; u32 first, count; } bands[Stereo::EYE_AMOUNT][CAMERA_TILE_ROWS];
+        for(u32 eye = 0; eye < Stereo::EYE_AMOUNT; eye++)
+            for(u32 i = 0; i < CAMERA_TILE_ROWS; i++)
+                bands[eye][i] = {src.data() + eye*CAMERA_BUFFER_SIZE, dst.data() + eye*CAMERA_TEXTURE_WIDTH*CAMERA_TEXTURE_HEIGHT, i, 1};
+        for(u32 eyes = 1; eyes <= Stereo::EYE_AMOUNT; eyes++)
+        {
+            for(u32 workers = 0; workers < 4; workers++)
+            {
+                JobSystem jobs(workers);
+                constexpr u32 ITERATIONS = 1000;
+                auto start = Clock::now();
+                for(u32 i = 0; i < ITERATIONS; i++)
+                {
+                    for(u32 eye = 0; eye < eyes; eye++)
+                        for(auto& band : bands[eye])
+                            jobs.add([](void* data) {
+                                Band* band = (Band*)data;
+                                Swizzle::convertTileRows<Swizzle::FORMAT_RGB565, CAMERA_BUFFER_WIDTH, CAMERA_TEXTURE_WIDTH>(band->src, band->dst, band->first, band->count);
+                            }, &band);
+                    jobs.run();
+                }
+                char name[64];
+                snprintf(name, sizeof(name), "camera %s, %u thread(s)", eyes == 1 ? "frame" : "pair", jobs.threadCount());
+                benchmark(name, ITERATIONS, secondsSince(start));
+            }
+        }
+    }
+
+    // The grid against looking at every splash, the way visibility was worked out before it, from a handful of splashes to far more than a game has
+    for(u32 count : {10, 100, 1000, 10000, 100000})
+    {
+        AngularGrid<u32> grid;
+        std::vector<float> anglesX(count), anglesY(count);
+        for(u32 i = 0; i < count; i++)
+        {
+            anglesX[i] = (i*7919 % 3600)/10.0f - 180;
+            anglesY[i] = (i*104729 % 3600)/10.0f - 180;
+            grid.insert(i, anglesX[i], anglesY[i]);
+        }
+
+        std::vector<u32> out;
+        u32 iterations = std::max(10000000/count, 100u);
+        char name[64];
+        auto start = Clock::now();
+        for(u32 i = 0; i < iterations; i++)
+            grid.query((i % 360) - 180.0f, ((i*7) % 360) - 180.0f, 67.5f, out);
+        snprintf(name, sizeof(name), "visibility query, %u splashes", count);
+        benchmark(name, iterations, secondsSince(start));
+
+        start = Clock::now();
+        for(u32 i = 0; i < iterations; i++)
+        {
+            float tX = (i % 360) - 180.0f, tY = ((i*7) % 360) - 180.0f;
+            out.clear();
+            for(u32 j = 0; j < count; j++)
+                if(std::abs(angleDelta(anglesX[j], tX)) <= 67.5f && std::abs(angleDelta(anglesY[j], tY)) <= 67.5f)
+                    out.push_back(j);
+        }
+        snprintf(name, sizeof(name), "visibility scan, %u splashes", count);
+        benchmark(name, iterations, secondsSince(start));
+    }
+
+    {
+        // Thousands of splashes in the beam's center at once, each of a color of its own
+        SplashPool pool(4096);
+        DamageTable table;
+        table.setWater(1, Platform::color32(0xC0, 0x40, 0x40, 0xFF), 5);
+        std::vector<SplashHandle> candidates, killed;
+        for(u32 i = 0; i < 4096; i++)
+            candidates.push_back(pool.add((i % 64)/4.0f - 8, (i/64)/4.0f - 8, 0, 1e9f, i*2654435761u, 0));
+
+        constexpr u32 ITERATIONS = 2000;
+        for(auto mode : {DamageTable::BEAM_PIERCE, DamageTable::BEAM_FIRST_HIT})
+        {
+            DamageTable::Beam beam = {0, 0, 8, 1, mode};
+            auto start = Clock::now();
+            for(u32 i = 0; i < ITERATIONS; i++)
+                table.hit(pool, beam, candidates, killed);
+            benchmark(mode == DamageTable::BEAM_PIERCE ? "piercing beam, 4k splashes" : "first hit beam, 4k splashes", ITERATIONS, secondsSince(start));
+        }
+
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            table.setWater(1, Platform::color32(0xC0, 0x40, i, 0xFF), 5);
+        benchmark("damage table rebuild", ITERATIONS, secondsSince(start));
+    }
+
+    {
+        // A step's look at every splash: those in the beam's center are hurt, those in view collected for drawing
+        // First each splash behind its own allocation, as they were before SplashPool, in the order removals leave them in,
+        // then the same splashes in the pool's arrays
+        struct HeapSplash
+        {
+            float tX, tY, tZ;
+            float health;
+            u32 color;
+            bool boss;
+        };
+
+        for(u32 count : {1000, 10000})
+        {
+            Random random(count);
+            SplashPool pool(count);
+            std::vector<HeapSplash*> heapSplashes;
+            std::vector<std::vector<u8>> between; // whatever else the game allocated meanwhile
+            for(u32 i = 0; i < count; i++)
+            {
+                float tX = random.uniform()*360 - 180, tY = random.uniform()*360 - 180;
+                heapSplashes.push_back(new HeapSplash{tX, tY, 0, 1e9f, 0, false});
+                between.emplace_back(16 + random.below(256));
+                pool.add(tX, tY, 0, 1e9f, 0, 0);
+            }
+            between.clear();
+            for(u32 i = count - 1; i > 0; i--)
+                std::swap(heapSplashes[i], heapSplashes[random.below(i + 1)]);
+
+            u32 iterations = 10000000/count;
+            std::vector<HeapSplash*> visibleSplashes;
+            char name[64];
+            auto start = Clock::now();
+            for(u32 i = 0; i < iterations; i++)
+            {
+                float tX = (i % 360) - 180.0f, tY = ((i*7) % 360) - 180.0f;
+                visibleSplashes.clear();
+                for(HeapSplash* splash : heapSplashes)
+                {
+                    float dX = std::abs(angleDelta(splash->tX, tX)), dY = std::abs(angleDelta(splash->tY, tY));
+                    if(dX <= 8 && dY <= 8)
+                        splash->health -= 1;
+                    if(dX <= 67.5f && dY <= 67.5f)
+                        visibleSplashes.push_back(splash);
+                }
+            }
+            snprintf(name, sizeof(name), "splash step, %u on the heap", count);
+            benchmark(name, iterations, secondsSince(start));
+
+            std::vector<u32> visibleIndices;
+            start = Clock::now();
+            for(u32 i = 0; i < iterations; i++)
+            {
+                float tX = (i % 360) - 180.0f, tY = ((i*7) % 360) - 180.0f;
+                const float* anglesX = pool.anglesX();
+                const float* anglesY = pool.anglesY();
+                float* healths = pool.healths();
+                visibleIndices.clear();
+                for(u32 j = 0; j < pool.size(); j++)
+                {
+                    float dX = std::abs(angleDelta(anglesX[j], tX)), dY = std::abs(angleDelta(anglesY[j], tY));
+                    if(dX <= 8 && dY <= 8)
+                        healths[j] -= 1;
+                    if(dX <= 67.5f && dY <= 67.5f)
+                        visibleIndices.push_back(j);
+                }
+            }
+            snprintf(name, sizeof(name), "splash step, %u in the pool", count);
+            benchmark(name, iterations, secondsSince(start));
+
+            for(HeapSplash* splash : heapSplashes)
+                delete splash;
+        }
+    }
+
+    {
+        // A frame's worth of splash quads, from the arena or from the heap
+        constexpr u32 ITERATIONS = 100000, QUADS = 200;
+        FrameArena arena(64*1024);
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+        {
+            arena.reset();
+            Platform::Quad* quads = arena.allocate<Platform::Quad>(QUADS);
+            quads[i % QUADS].x = i;
+        }
+        benchmark("frame arena allocation", ITERATIONS, secondsSince(start));
+
+        start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+        {
+            std::vector<Platform::Quad> quads(QUADS);
+            quads[i % QUADS].x = i;
+        }
+        benchmark("heap allocation", ITERATIONS, secondsSince(start));
+    }
+
+    {
+        Random random(1);
+        constexpr u32 ITERATIONS = 10000000;
+        volatile u32 sum = 0;
+        auto start = Clock::now();
+        for(u32 i = 0; i < ITERATIONS; i++)
+            sum += random.next();
+        benchmark("random number", ITERATIONS, secondsSince(start));
+    }
+
+    {
+        // A frame's worth of ticks with 10k events waiting, keeping as many pending as fire
+        TimerWheel wheel;
+        Random random(2);
+        for(u32 i = 0; i < 10000; i++)
+            wheel.schedule(1 + random.below(36000), 0, i);
+        std::vector<TimerWheel::Event> due;
+        constexpr u32 ITERATIONS = 36000;
+        auto start = Clock::now();
+        for(u32 i = 1; i <= ITERATIONS; i++)
+        {
+            due.clear();
+            wheel.advance(i, due);
+            for(auto& event : due)
+                wheel.schedule(event.time + 1 + random.below(36000), 0, event.argument);
+        }
+        benchmark("timer wheel frame, 10k events", ITERATIONS, secondsSince(start));
+    }
+
+    {
+        const char* path = "bench_replay.bin";
+        constexpr u32 SECONDS = 600;
+        writeSyntheticLog(path, SECONDS, 7);
+        ReplayResult result = replay(path);
+        benchmark("replayed frame", result.frames, result.seconds);
+        printf("%u s of play replayed in %.2f s (%.0fx real time)\n", SECONDS, result.seconds, SECONDS/result.seconds);
+        remove(path);
+    }
+}
+
+static void usage()
+{
+    printf("usage: paintar_host replay <log> [waves]\n");
+    printf("       paintar_host synthesize <log> <seconds>\n");
+    printf("       paintar_host test\n");
+    printf("       paintar_host bench\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2)
+    {
+        usage();
+        return 1;
+    }
+
+    if(!strcmp(argv[1], "replay") && (argc == 3 || argc == 4))
+    {
+        ReplayResult result = replay(argv[2], argc == 4 ? argv[3] : "");
+        printf("frames: %u\nhits: %d\nsplashes: %zu\nchecksum: %08x\ntime: %.3f s\n", result.frames, result.hitCounter, result.splashes, result.checksum, result.seconds);
+        Memory::report();
+        return 0;
+    }
+
+    if(!strcmp(argv[1], "synthesize") && argc == 4)
+        return writeSyntheticLog(argv[2], atoi(argv[3]), (u32)Platform::ticks()) ? 0 : 1;
+
+    // The game logs every kill to stderr, which would drown the results
+    if(!strcmp(argv[1], "test"))
+    {
+        freopen("/dev/null", "w", stderr);
+        testSwizzle();
+        testYuv();
+        testTripleBuffer();
+        testCaptureRing();
+        testRandom();
+        testTimerWheel();
+        testWaves();
+        testSplashPool();
+        testDamage();
+        testMemory();
+        testFastMath();
+        testAngularGrid();
+        testOrientation();
+        testRecording();
+        testReplay();
+        testProfiler();
+        testDrawList();
+        testStereo();
+        testOpticalFlow();
+        testVisualCorrection();
+        testPalette();
+        testPanorama();
+        testDecals();
+        testJobs();
+        testStartup();
+        testCaptureGovernor();
+        printf("%d failure(s)\n", failures);
+        return failures != 0;
+    }
+
+    if(!strcmp(argv[1], "bench"))
+    {
+        freopen("/dev/null", "w", stderr);
+        runBenchmarks();
+        return 0;
+    }
+
+    usage();
+    return 1;
+}
@@ -0,0 +1,442 @@
+#include "platform_host.h"
+#include "camera.h"
+#include "yuv.h"
+#include "capture_ring.h"
+#include "object_pool.h"
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <algorithm>
+
+namespace Platform
+{
+    const char* const DATA_DIRECTORY = ".";
+
+    static std::vector<DrawCommand> pendingCommands, finishedCommands;
+    static Screen currentScreen = SCREEN_TOP;
+    static bool stereo = false;
+    static float slider = 0.0f;
+    static bool yuvConversion = false;
+    static u32 yuvConversionCount = 0;
+
+    struct ThreadData
+    {
+        std::thread thread;
+    };
+
+    struct TextureData
+    {
+        u16 width, height;
+        u16 areaWidth, areaHeight;
+        u32 bytes;
+        std::vector<u16> pixels; // RGBA8 texels take two
+    };
+
+    struct DrawListData
+    {
+        std::vector<Quad> quads;
+        std::vector<u32> order;
+        bool sorted;
+    };
+
+    struct TextData
+    {
+        std::vector<char> string;
+        size_t capacity; // 0 for static text
+    };
+
+    static ObjectPool<TextData, MAX_TEXTS> texts(Memory::TAG_TEXT);
+
+    // Nothing to bring up, there is no hardware behind any of this
+    void init() {}
+    void initSensors() {}
+    void loadSprites() {}
+    void initYuvConversion() {}
+    void exit() {}
+
+    bool mainLoop()
+    {
+        return true;
+    }
+
+    // There is no console to read from, replays bring their own input
+    void readInput(Input* input)
+    {
+        memset(input, 0, sizeof(Input));
+    }
+
+    u64 ticks()
+    {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        u64 nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+        return (u64)((unsigned __int128)nanoseconds*TICKS_PER_SECOND/1000000000);
+    }
+
+    void sleep(u64 nanoseconds)
+    {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(nanoseconds));
+    }
+
+    Thread createThread(void (*entry)(void*), void* arg, size_t stackSize, int priority, int core)
+    {
+        (void)stackSize;
+        (void)priority;
+        (void)core;
+        Thread thread = new ThreadData;
+        thread->thread = std::thread(entry, arg);
+        return thread;
+    }
+
+    void joinThread(Thread thread)
+    {
+        thread->thread.join();
+        delete thread;
+    }
+
+    u32 coreCount()
+    {
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // There is no DMA, any memory will do
+    void* allocateLinear(size_t size, Memory::Tag tag)
+    {
+        void* pointer = malloc(size);
+        if(pointer != NULL)
+            Memory::account(tag, size);
+        return pointer;
+    }
+
+    void freeLinear(void* pointer, size_t size, Memory::Tag tag)
+    {
+        if(pointer == NULL)
+            return;
+        free(pointer);
+        Memory::release(tag, size);
+    }
+
+    Mutex::Mutex()
+    {
+        this->handle = new std::mutex;
+    }
+
+    Mutex::~Mutex()
+    {
+        delete (std::mutex*)this->handle;
+    }
+
+    void Mutex::lock()
+    {
+        ((std::mutex*)this->handle)->lock();
+    }
+
+    void Mutex::unlock()
+    {
+        ((std::mutex*)this->handle)->unlock();
+    }
+
+    struct SemaphoreData
+    {
+        std::mutex mutex;
+        std::condition_variable available;
+        u32 count = 0;
+    };
+
+    Semaphore::Semaphore()
+    {
+        this->handle = new SemaphoreData;
+    }
+
+    Semaphore::~Semaphore()
+    {
+        delete (SemaphoreData*)this->handle;
+    }
+
+    void Semaphore::acquire()
+    {
+        SemaphoreData* semaphore = (SemaphoreData*)this->handle;
+        std::unique_lock<std::mutex> lock(semaphore->mutex);
+        semaphore->available.wait(lock, [semaphore]() { return semaphore->count > 0; });
+        semaphore->count--;
+    }
+
+    void Semaphore::release(u32 count)
+    {
+        SemaphoreData* semaphore = (SemaphoreData*)this->handle;
+        {
+            std::lock_guard<std::mutex> lock(semaphore->mutex);
+            semaphore->count += count;
+        }
+        if(count == 1)
+            semaphore->available.notify_one();
+        else
+            semaphore->available.notify_all();
+    }
+
+    // A scrolling gradient at the mode's frame rate, the right camera sees it a few pixels to the left
+    void captureCamera(TripleBuffer<u16>* frames, const CameraMode& mode, volatile bool* stop, void (*process)(const u16* frame, void* data), void* data)
+    {
+        constexpr u32 DISPARITY = 4;
+        CaptureRing ring(frames, mode.cameras, CAMERA_BUFFER_SIZE);
+        u32 frame = 0;
+        while(!*stop)
+        {
+            const u16* published = NULL;
+            for(u32 camera = 0; camera < mode.cameras; camera++)
+            {
+                u16* pixels = ring.target(camera);
+                for(u32 y = 0; y < mode.height; y++)
+                {
+                    for(u32 x = 0; x < mode.width; x++)
+                    {
+                        u16* pixel = &pixels[y*mode.width + x];
+                        if(mode.format == CAMERA_YUV422)
+                            *pixel = ((x + camera*DISPARITY + frame) & 0xFF) | (((x & 1 ? frame : y + frame) & 0xFF) << 8);
+                        else
+                            *pixel = (((x + camera*DISPARITY + frame) & 0x1F) << 11) | (((y + frame) & 0x3F) << 5) | (frame & 0x1F);
+                    }
+                }
+                published = ring.received(camera);
+            }
+            process(published, data);
+            frame++;
+            sleep(1000000000/mode.frameRate);
+        }
+    }
+
+    void beginFrame()
+    {
+        pendingCommands.clear();
+    }
+
+    void beginScreen(Screen screen, u32 clearColor)
+    {
+        (void)clearColor;
+        currentScreen = screen;
+    }
+
+    void setStereo(bool enabled)
+    {
+        stereo = enabled;
+    }
+
+    float stereoSlider()
+    {
+        return slider;
+    }
+
+    bool stereoEnabled()
+    {
+        return stereo;
+    }
+
+    void setStereoSlider(float value)
+    {
+        slider = value;
+    }
+
+    void setYuvConversion(bool available)
+    {
+        yuvConversion = available;
+    }
+
+    u32 yuvConversions()
+    {
+        return yuvConversionCount;
+    }
+
+    bool hasYuvConversion()
+    {
+        return yuvConversion;
+    }
+
+    bool convertYuvToTexture(const u16* frame, u16 width, u16 height, Texture texture)
+    {
+        if(!yuvConversion)
+            return false;
+
+        Yuv::convertTileRows<CAMERA_BUFFER_WIDTH, CAMERA_TEXTURE_WIDTH>(frame, texture->pixels.data(), 0, height/8, width);
+        yuvConversionCount++;
+        return true;
+    }
+
+    void endFrame()
+    {
+        finishedCommands.swap(pendingCommands);
+    }
+
+    const std::vector<DrawCommand>& drawCommands()
+    {
+        return finishedCommands;
+    }
+
+    Texture createTexture(u16 width, u16 height, TextureFormat format)
+    {
+        Texture texture = new TextureData;
+        texture->width = texture->areaWidth = width;
+        texture->height = texture->areaHeight = height;
+        texture->bytes = width*height*(format == TEXTURE_RGBA8 ? sizeof(u32) : sizeof(u16));
+        texture->pixels.resize(texture->bytes/sizeof(u16));
+        Memory::account(Memory::TAG_TEXTURES, texture->bytes);
+        return texture;
+    }
+
+    void deleteTexture(Texture texture)
+    {
+        Memory::release(Memory::TAG_TEXTURES, texture->bytes);
+        delete texture;
+    }
+
+    void setTextureArea(Texture texture, u16 width, u16 height)
+    {
+        texture->areaWidth = width;
+        texture->areaHeight = height;
+    }
+
+    void* textureData(Texture texture)
+    {
+        return texture->pixels.data();
+    }
+
+    void flushTexture(Texture texture)
+    {
+        (void)texture;
+    }
+
+    void drawTexture(Texture texture, float x, float y, float depth, float scaleX, float scaleY)
+    {
+        pendingCommands.push_back({DRAW_TEXTURE, currentScreen, 0, x, y, depth, texture->areaWidth*scaleX, texture->areaHeight*scaleY, 1.0f, 0xFFFFFFFF});
+    }
+
+    void drawTextureWrapped(Texture texture, float u, float v, float width, float height, float x, float y, float depth, float screenWidth, float screenHeight)
+    {
+        (void)texture;
+        (void)u;
+        (void)v;
+        (void)width;
+        (void)height;
+        pendingCommands.push_back({DRAW_TEXTURE, currentScreen, 0, x, y, depth, screenWidth, screenHeight, 1.0f, 0xFFFFFFFF});
+    }
+
+    void drawImage(u32 image, float x, float y, float depth, float scale)
+    {
+        pendingCommands.push_back({DRAW_IMAGE, currentScreen, image, x, y, depth, 0, 0, scale, 0xFFFFFFFF});
+    }
+
+    void drawImageTinted(u32 image, float x, float y, float depth, u32 color, float scale)
+    {
+        pendingCommands.push_back({DRAW_IMAGE, currentScreen, image, x, y, depth, 0, 0, scale, color});
+    }
+
+    void drawRect(float x, float y, float depth, float width, float height, u32 color)
+    {
+        pendingCommands.push_back({DRAW_RECT, currentScreen, 0, x, y, depth, width, height, 1.0f, color});
+    }
+
+    DrawList createDrawList(const Quad* quads, u32 count)
+    {
+        DrawList list = new DrawListData;
+        setQuads(list, quads, count);
+        return list;
+    }
+
+    void deleteDrawList(DrawList list)
+    {
+        delete list;
+    }
+
+    void setQuad(DrawList list, u32 index, const Quad& quad)
+    {
+        Quad& old = list->quads[index];
+        if(old.image != quad.image || old.depth != quad.depth)
+            list->sorted = false;
+        old = quad;
+    }
+
+    void setQuads(DrawList list, const Quad* quads, u32 count)
+    {
+        list->quads.assign(quads, quads + count);
+        list->order.clear();
+        for(u32 i = 0; i < count; i++)
+            list->order.push_back(i);
+        list->sorted = false;
+    }
+
+    // Every image is in the one sprite sheet, so it's a single draw call like on the console
+    DrawStats drawDrawList(DrawList list, float offsetX)
+    {
+        if(!list->sorted)
+        {
+            std::stable_sort(list->order.begin(), list->order.end(), [list](u32 a, u32 b) {
+                bool aImage = list->quads[a].image != NO_IMAGE, bImage = list->quads[b].image != NO_IMAGE;
+                if(aImage != bImage)
+                    return bImage;
+                return list->quads[a].depth < list->quads[b].depth;
+            });
+            list->sorted = true;
+        }
+
+        for(auto index : list->order)
+        {
+            const Quad& quad = list->quads[index];
+            if(quad.image == NO_IMAGE)
+                pendingCommands.push_back({DRAW_RECT, currentScreen, 0, quad.x + offsetX, quad.y, quad.depth, quad.width, quad.height, 1.0f, quad.color});
+            else
+                pendingCommands.push_back({DRAW_IMAGE, currentScreen, quad.image, quad.x + offsetX, quad.y, quad.depth, 0, 0, quad.scale, quad.tinted ? quad.color : 0xFFFFFFFF});
+        }
+        return { (u32)list->order.size()*6, list->order.empty() ? 0u : 1u };
+    }
+
+    Text createText(const char* string)
+    {
+        Text text = texts.create();
+        text->string.assign(string, string + strlen(string) + 1);
+        text->capacity = 0;
+        return text;
+    }
+
+    Text createText(size_t capacity)
+    {
+        Text text = texts.create();
+        text->string.assign(capacity+1, '\0');
+        text->capacity = capacity;
+        Memory::account(Memory::TAG_TEXT, text->string.size());
+        return text;
+    }
+
+    bool setText(Text text, const char* string)
+    {
+        if(!strncmp(text->string.data(), string, text->capacity))
+            return false;
+
+        strncpy(text->string.data(), string, text->capacity);
+        return true;
+    }
+
+    // Roughly the system font's advance at scale 1
+    float textWidth(Text text, float scale)
+    {
+        return strlen(text->string.data())*12.0f*scale;
+    }
+
+    void deleteText(Text text)
+    {
+        if(text->capacity > 0)
+            Memory::release(Memory::TAG_TEXT, text->string.size());
+        texts.destroy(text);
+    }
+
+    void drawText(Text text, float x, float y, float depth, float scale, u32 color)
+    {
+        (void)text;
+        pendingCommands.push_back({DRAW_TEXT, currentScreen, 0, x, y, depth, 0, 0, scale, color});
+    }
+
+    void drawText(const char* string, float x, float y, float depth, float scale, u32 color)
+    {
+        (void)string;
+        pendingCommands.push_back({DRAW_TEXT, currentScreen, 0, x, y, depth, 0, 0, scale, color});
+    }
+}
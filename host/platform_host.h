@@ -0,0 +1,38 @@
+#pragma once
+
+#include "platform.h"
+#include <vector>
+
+// Host only additions to the platform layer: draws are recorded instead of rendered
+namespace Platform
+{
+    typedef enum
+    {
+        DRAW_TEXTURE,
+        DRAW_IMAGE,
+        DRAW_RECT,
+        DRAW_TEXT,
+    } DrawType;
+
+    typedef struct
+    {
+        DrawType type;
+        Screen screen;
+        u32 image; // sprite sheet index for DRAW_IMAGE
+        float x, y, depth;
+        float width, height; // DRAW_RECT, and DRAW_TEXTURE as drawn
+        float scale;
+        u32 color;
+    } DrawCommand;
+
+    // Everything submitted between the last beginFrame and endFrame pair
+    const std::vector<DrawCommand>& drawCommands();
+
+    // What the game last asked of the 3D screen, and where the 3D slider stands in for the console's
+    bool stereoEnabled();
+    void setStereoSlider(float value);
+
+    // Whether convertYuvToTexture stands in for the Y2R unit with Yuv's conversion, off like a console without one by default
+    void setYuvConversion(bool available);
+    u32 yuvConversions(); // made since the start
+}
@@ -0,0 +1,22 @@
+// Generated by tex3ds from sprites/sprites.t3s on the console build, kept in sync by hand for the host one
+#pragma once
+
+#define sprites_gun_idx 0
+#define sprites_paint_idx 1
+#define sprites_water_overlay_idx 2
+#define sprites_water_overloaded_idx 3
+#define sprites_water_type_idx 4
+#define sprites_water_selected_idx 5
+#define sprites_counter_overlay_idx 6
+#define sprites_0_idx 7
+#define sprites_1_idx 8
+#define sprites_2_idx 9
+#define sprites_3_idx 10
+#define sprites_4_idx 11
+#define sprites_5_idx 12
+#define sprites_6_idx 13
+#define sprites_7_idx 14
+#define sprites_8_idx 15
+#define sprites_9_idx 16
+#define sprites_beam_water_idx 17
+#define sprites_beam_steal_idx 18
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "types.h"
+#include "fast_math.h"
+#include <array>
+#include <vector>
+#include <cmath>
+
+// Signed difference a-b between two angles in degrees, wrapped to [-180, 180)
+// so that 179 and -179 are 2 degrees apart instead of 358
+inline float angleDelta(float a, float b)
+{
+    return FastMath::wrapDegrees(a - b);
+}
+
+// Buckets items by their (tX, tY) angles on a CELLS*CELLS grid that wraps around at +-180 degrees,
+// so a box query only looks at the handful of cells it overlaps instead of every item
+template<typename T>
+class AngularGrid
+{
+    public:
+        static constexpr u32 CELLS = 32;
+        static constexpr float CELL_ANGLE = 360.0f/CELLS;
+
+        void insert(T item, float tX, float tY)
+        {
+            this->cells[cellIndex(tX, tY)].push_back({item, tX, tY});
+            this->count++;
+        }
+
+        // The angles have to be the ones the item was inserted with
+        bool remove(T item, float tX, float tY)
+        {
+            auto& cell = this->cells[cellIndex(tX, tY)];
+            for(size_t i = 0; i < cell.size(); i++)
+            {
+                if(cell[i].item == item)
+                {
+                    cell[i] = cell.back();
+                    cell.pop_back();
+                    this->count--;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void clear()
+        {
+            for(auto& cell : this->cells)
+                cell.clear();
+            this->count = 0;
+        }
+
+        size_t size() const { return this->count; }
+
+        // Replaces the contents of out with every item at most radius degrees away from (tX, tY) on both axes
+        void query(float tX, float tY, float radius, std::vector<T>& out) const
+        {
+            out.clear();
+
+            u32 firstX = cellCoordinate(tX - radius), spanX = cellSpan(firstX, cellCoordinate(tX + radius), radius);
+            u32 firstY = cellCoordinate(tY - radius), spanY = cellSpan(firstY, cellCoordinate(tY + radius), radius);
+
+            for(u32 y = 0; y < spanY; y++)
+            {
+                u32 row = ((firstY + y) % CELLS)*CELLS;
+                for(u32 x = 0; x < spanX; x++)
+                {
+                    for(const auto& entry : this->cells[row + (firstX + x) % CELLS])
+                    {
+                        if(std::abs(angleDelta(entry.tX, tX)) <= radius && std::abs(angleDelta(entry.tY, tY)) <= radius)
+                            out.push_back(entry.item);
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            T item;
+            float tX, tY;
+        };
+
+        static u32 cellCoordinate(float angle)
+        {
+            float wrapped = angleDelta(angle, 0) + 180; // [0, 360)
+            u32 coordinate = (u32)(wrapped/CELL_ANGLE);
+            return coordinate < CELLS ? coordinate : CELLS-1;
+        }
+
+        // Number of cells from first to last going up and wrapping around, all of them if the box is wider than the circle
+        static u32 cellSpan(u32 first, u32 last, float radius)
+        {
+            if(radius*2 + CELL_ANGLE >= 360)
+                return CELLS;
+            return (last + CELLS - first) % CELLS + 1;
+        }
+
+        static u32 cellIndex(float tX, float tY)
+        {
+            return cellCoordinate(tY)*CELLS + cellCoordinate(tX);
+        }
+
+        std::array<std::vector<Entry>, CELLS*CELLS> cells;
+        size_t count = 0;
+};
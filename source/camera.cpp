@@ -1,121 +1,177 @@
 #include "camera.h"
+#include "swizzle.h"
+#include "yuv.h"
+#include "optical_flow.h"
+#include "palette.h"
+#include <algorithm>
+#include <cstring>
 
 camera_arg * arg = NULL;
 
-void cameraThreadFunction(void* void_arg)
+// Runs on the camera thread for every frame, before the game gets to see it
+static void processCameraFrame(const u16* frame, void* void_arg)
 {
     (void)void_arg;
-    Handle events[2] = {0};
-    u32 transferUnit;
-
-    u16* buffer = new u16[CAMERA_BUFFER_SIZE];
-    camInit();
-    CAMU_SetSize(SELECT_OUT1, SIZE_CTR_TOP_LCD, CONTEXT_A);
-    CAMU_SetOutputFormat(SELECT_OUT1, OUTPUT_RGB_565, CONTEXT_A);
-    CAMU_SetFrameRate(SELECT_OUT1, FRAME_RATE_30);
-    CAMU_SetNoiseFilter(SELECT_OUT1, true);
-    CAMU_SetAutoExposure(SELECT_OUT1, true);
-    CAMU_SetAutoWhiteBalance(SELECT_OUT1, true);
-    CAMU_Activate(SELECT_OUT1);
-    CAMU_GetBufferErrorInterruptEvent(&events[1], PORT_CAM1);
-    CAMU_SetTrimming(PORT_CAM1, false);
-    CAMU_GetMaxBytes(&transferUnit, CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT);
-    CAMU_SetTransferBytes(PORT_CAM1, transferUnit, CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT);
-    CAMU_ClearBuffer(PORT_CAM1);
-    CAMU_SetReceiving(&events[0], buffer, PORT_CAM1, CAMERA_BUFFER_SIZE_BYTES, (s16) transferUnit);
-    CAMU_StartCapture(PORT_CAM1);
-
-    while(!arg->stop)
-    {
-        s32 index = 0;
-        svcWaitSynchronizationN(&index, events, 2, false, U64_MAX);
-        switch(index+1)
-        {
-            case 1:
-                svcCloseHandle(events[0]);
-                events[0] = 0;
-                svcWaitSynchronization(arg->mutex, U64_MAX);
-                memcpy(arg->camera_buffer, buffer, CAMERA_BUFFER_SIZE_BYTES);
-                GSPGPU_FlushDataCache(arg->camera_buffer, CAMERA_BUFFER_SIZE_BYTES);
-                svcReleaseMutex(arg->mutex);
-                CAMU_SetReceiving(&events[0], buffer, PORT_CAM1, CAMERA_BUFFER_SIZE_BYTES, transferUnit);
-                break;
-            case 2:
-                svcCloseHandle(events[0]);
-                events[0] = 0;
-                CAMU_ClearBuffer(PORT_CAM1);
-                CAMU_SetReceiving(&events[0], buffer, PORT_CAM1, CAMERA_BUFFER_SIZE_BYTES, transferUnit);
-                CAMU_StartCapture(PORT_CAM1);
-                break;
-            default:
-                break;
-        }
-    }
+    float shiftX = 0.0f, shiftY = 0.0f;
+    bool found = arg->flow->update(frame, &shiftX, &shiftY);
 
-    CAMU_StopCapture(PORT_CAM1);
+    u32 colors[CAMERA_PALETTE_COLORS] = {0};
+    arg->palette->update(frame);
+    arg->palette->topColors(colors, CAMERA_PALETTE_COLORS);
 
-    bool busy = false;
-    while(R_SUCCEEDED(CAMU_IsBusy(&busy, PORT_CAM1)) && busy)
+    arg->motionLock.lock();
+    memcpy(arg->paletteColors, colors, sizeof(colors));
+    if(found)
     {
-        svcSleepThread(1e6);
+        arg->motionX += shiftX;
+        arg->motionY += shiftY;
     }
+    else
+    {
+        arg->motionLost = true;
+    }
+    arg->motionFrames++;
+    arg->motionLock.unlock();
+}
 
-    CAMU_ClearBuffer(PORT_CAM1);
-    CAMU_Activate(SELECT_NONE);
-    camExit();
-    
-    delete[] buffer;
+void cameraThreadFunction(void* void_arg)
+{
+    (void)void_arg;
+    Platform::captureCamera(arg->frames, arg->mode, &arg->stop, processCameraFrame, NULL);
+}
 
-    for(int i = 0; i < 2; i++)
+void startCameraThread(const Platform::CameraMode& mode)
+{
+    arg = Memory::create<camera_arg>(Memory::TAG_CAMERA);
+    arg->stop = false;
+    arg->mode = mode;
+    for(auto& buffer : arg->camera_buffers)
+        buffer = (u16*)Platform::allocateLinear(CAMERA_BUFFER_SIZE_BYTES*mode.cameras, Memory::TAG_CAMERA_FRAMES);
+    arg->frames = Memory::create<TripleBuffer<u16>>(Memory::TAG_CAMERA, arg->camera_buffers[0], arg->camera_buffers[1], arg->camera_buffers[2]);
+    for(u32 eye = 0; eye < Stereo::EYE_AMOUNT; eye++)
     {
-        if(events[i] != 0)
+        arg->textures[eye] = NULL;
+        if(eye < mode.cameras)
         {
-            svcCloseHandle(events[i]);
-            events[i] = 0;
+            arg->textures[eye] = Platform::createTexture(CAMERA_TEXTURE_WIDTH, CAMERA_TEXTURE_HEIGHT);
+            Platform::setTextureArea(arg->textures[eye], mode.width, mode.height);
         }
     }
-
-    arg->done = true;
+    arg->flow = Memory::create<OpticalFlow>(Memory::TAG_CAMERA);
+    arg->flow->setArea(mode.width, mode.height, (Platform::CameraFormat)mode.format);
+    arg->palette = Memory::create<Palette>(Memory::TAG_CAMERA);
+    arg->palette->setArea(mode.width, mode.height, (Platform::CameraFormat)mode.format);
+    memset(arg->paletteColors, 0, sizeof(arg->paletteColors));
+    arg->motionX = arg->motionY = 0.0f;
+    arg->motionFrames = 0;
+    arg->motionLost = false;
+    arg->thread = Platform::createThread(cameraThreadFunction, NULL, 0x10000, 0x1A, 1);
 }
 
-void startCameraThread()
+void closeCameraThread()
 {
-    arg = new camera_arg;
-    arg->stop = false;
-    svcCreateMutex(&arg->mutex, false);
+    arg->stop = true;
+    if(arg->thread != NULL)
+        Platform::joinThread(arg->thread);
 
-    C3D_Tex * tex = new C3D_Tex;
-    static const Tex3DS_SubTexture subt3x = { 512, 256, 0.0f, 1.0f, 1.0f, 0.0f };
-    arg->image = (C2D_Image){ tex, &subt3x };
-    C3D_TexInit(arg->image.tex, 512, 256, GPU_RGB565);
-    C3D_TexSetFilter(arg->image.tex, GPU_LINEAR, GPU_LINEAR);
+    for(auto texture : arg->textures)
+        if(texture != NULL)
+            Platform::deleteTexture(texture);
+    Memory::destroy(Memory::TAG_CAMERA, arg->flow);
+    Memory::destroy(Memory::TAG_CAMERA, arg->palette);
+    Memory::destroy(Memory::TAG_CAMERA, arg->frames);
+    for(auto buffer : arg->camera_buffers)
+        Platform::freeLinear(buffer, CAMERA_BUFFER_SIZE_BYTES*arg->mode.cameras, Memory::TAG_CAMERA_FRAMES);
+    Memory::destroy(Memory::TAG_CAMERA, arg);
+}
+
+// Returns false, leaving the texture untouched, if the camera hasn't delivered a new frame since the last call
+bool convertCameraBuffer()
+{
+    if(!acquireCameraFrame())
+        return false;
 
-    if(threadCreate(cameraThreadFunction, NULL, 0x10000, 0x1A, 1, true) == NULL)
+    for(u32 eye = 0; eye < arg->mode.cameras; eye++)
     {
-        arg->done = true;
+        if(convertCameraTexture((Stereo::Eye)eye))
+            continue;
+        convertCameraRows((Stereo::Eye)eye, 0, CAMERA_TILE_ROWS);
+        flushCameraTexture((Stereo::Eye)eye);
     }
+    return true;
 }
 
-void closeCameraThread()
+bool acquireCameraFrame()
 {
-    arg->stop = true;
-    while(!arg->done)
-        svcSleepThread(1e6);
+    return arg->frames->acquire();
+}
 
-    svcCloseHandle(arg->mutex);
-    delete arg->image.tex;
-    delete arg;
+// Frames are packed, so their rows are as far apart as the picture is wide, which is one of the few sizes the cameras give
+template<u32 width>
+static void convertRows(const u16* frame, u16* texture, u32 firstTileRow, u32 tileRows, bool yuv)
+{
+    if(yuv)
+        Yuv::convertTileRows<width, CAMERA_TEXTURE_WIDTH>(frame, texture, firstTileRow, tileRows);
+    else
+        Swizzle::convertTileRows<Swizzle::FORMAT_RGB565, width, CAMERA_TEXTURE_WIDTH>(frame, texture, firstTileRow, tileRows);
 }
 
-void convertCameraBuffer()
+void convertCameraRows(Stereo::Eye eye, u32 firstTileRow, u32 tileRows)
 {
-    for(u32 x = 0; x < CAMERA_BUFFER_WIDTH; x++)
+    u32 pictureRows = arg->mode.height/8;
+    if(firstTileRow >= pictureRows)
+        return;
+
+    const u16* frame = arg->frames->readBuffer() + eye*CAMERA_BUFFER_SIZE;
+    u16* texture = (u16*)Platform::textureData(arg->textures[eye]);
+    tileRows = std::min(tileRows, pictureRows - firstTileRow);
+    bool yuv = arg->mode.format == Platform::CAMERA_YUV422;
+    switch(arg->mode.width)
     {
-        for(u32 y = 0; y < CAMERA_BUFFER_HEIGHT; y++)
-        {
-            u32 dstPos = ((((y >> 3) * (512 >> 3) + (x >> 3)) << 6) + ((x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) | ((y & 4) << 3))) * 2;
-            u32 srcPos = (y * CAMERA_BUFFER_WIDTH + x) * sizeof(u16);
-            memcpy(&((u8*)arg->image.tex->data)[dstPos], &((u8*)arg->camera_buffer)[srcPos], sizeof(u16));
-        }
+        case 160:
+            convertRows<160>(frame, texture, firstTileRow, tileRows, yuv);
+            break;
+        case 320:
+            convertRows<320>(frame, texture, firstTileRow, tileRows, yuv);
+            break;
+        default:
+            convertRows<CAMERA_BUFFER_WIDTH>(frame, texture, firstTileRow, tileRows, yuv);
+            break;
     }
 }
+
+bool convertCameraTexture(Stereo::Eye eye)
+{
+    if(arg->mode.format != Platform::CAMERA_YUV422)
+        return false;
+
+    const u16* frame = arg->frames->readBuffer() + eye*CAMERA_BUFFER_SIZE;
+    return Platform::convertYuvToTexture(frame, arg->mode.width, arg->mode.height, arg->textures[eye]);
+}
+
+void flushCameraTexture(Stereo::Eye eye)
+{
+    Platform::flushTexture(arg->textures[eye]);
+}
+
+CameraMotion takeCameraMotion(float* angleX, float* angleY)
+{
+    arg->motionLock.lock();
+    CameraMotion motion = arg->motionLost ? MOTION_LOST : arg->motionFrames ? MOTION_FOUND : MOTION_NONE;
+    // The picture moves the opposite way the camera turns, so right and down are left and up
+    float degreesPerPixel = CAMERA_FIELD_OF_VIEW/arg->mode.width;
+    *angleX = arg->motionY*degreesPerPixel;
+    *angleY = arg->motionX*degreesPerPixel;
+    arg->motionX = arg->motionY = 0.0f;
+    arg->motionFrames = 0;
+    arg->motionLost = false;
+    arg->motionLock.unlock();
+    return motion;
+}
+
+void getCameraPalette(u32 colors[CAMERA_PALETTE_COLORS])
+{
+    arg->motionLock.lock();
+    memcpy(colors, arg->paletteColors, sizeof(arg->paletteColors));
+    arg->motionLock.unlock();
+}
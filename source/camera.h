@@ -1,21 +1,70 @@
 #pragma once
 
 #include "common.h"
+#include "triple_buffer.h"
+#include "stereo.h"
 
 #define CAMERA_BUFFER_WIDTH 400
 #define CAMERA_BUFFER_HEIGHT 240
 #define CAMERA_BUFFER_SIZE CAMERA_BUFFER_WIDTH*CAMERA_BUFFER_HEIGHT
 #define CAMERA_BUFFER_SIZE_BYTES CAMERA_BUFFER_SIZE*sizeof(u16)
 
+#define CAMERA_TEXTURE_WIDTH 512
+#define CAMERA_TEXTURE_HEIGHT 256
+
+#define CAMERA_FIELD_OF_VIEW 64.0f // the outer cameras see about 64 degrees across, whatever the picture's size
+#define CAMERA_PALETTE_COLORS 4
+
+class OpticalFlow;
+class Palette;
+
 typedef struct {
-    volatile bool stop, done;
-    C2D_Image image;
-    Handle mutex;
-    u16 camera_buffer[CAMERA_BUFFER_SIZE];
+    volatile bool stop;
+    Platform::Thread thread;
+    // In 3D each buffer holds the left eye's frame then the right eye's, which otherwise has no texture
+    // The cameras write straight into them, so they come from Platform::allocateLinear
+    Platform::CameraMode mode;
+    Platform::Texture textures[Stereo::EYE_AMOUNT];
+    u16* camera_buffers[3];
+    TripleBuffer<u16>* frames;
+
+    // Picture movement found on the camera thread, summed until the game takes it
+    OpticalFlow* flow;
+    Platform::Mutex motionLock;
+    float motionX, motionY;
+    u32 motionFrames;
+    bool motionLost;
+
+    // Also updated on the camera thread, paletteColors is its latest result and shares motionLock
+    Palette* palette;
+    u32 paletteColors[CAMERA_PALETTE_COLORS];
 } camera_arg;
 
+typedef enum {
+    MOTION_NONE, // no new frame since the last call
+    MOTION_LOST, // at least one frame couldn't be matched, the movement since the last call is unknown
+    MOTION_FOUND,
+} CameraMotion;
+
 extern camera_arg * arg;
 
-void startCameraThread();
+// Two cameras in the mode capture both outer ones, one for each eye
+void startCameraThread(const Platform::CameraMode& mode);
 void closeCameraThread();
-void convertCameraBuffer();
+bool convertCameraBuffer();
+
+// convertCameraBuffer in pieces: once a frame is acquired, ranges of tile rows of either eye can be converted from any thread,
+// and each eye's texture is flushed once its rows are all done
+// Rows below a smaller picture are skipped, so the ranges can always cover CAMERA_TILE_ROWS
+#define CAMERA_TILE_ROWS (CAMERA_BUFFER_HEIGHT/8)
+bool acquireCameraFrame();
+void convertCameraRows(Stereo::Eye eye, u32 firstTileRow, u32 tileRows);
+void flushCameraTexture(Stereo::Eye eye);
+// YUV422 frames can instead have a whole eye converted by the Y2R unit, which needs neither of the above
+// Returns false if it couldn't be done, the eye then has to go through them, which convert YUV422 on the CPU
+bool convertCameraTexture(Stereo::Eye eye);
+
+// How far the camera turned since the last call, in degrees around the console's x (up is positive) and y (left is positive) axes
+CameraMotion takeCameraMotion(float* angleX, float* angleY);
+// Most common colors around the player, most common first, 0 for those not known yet
+void getCameraPalette(u32 colors[CAMERA_PALETTE_COLORS]);
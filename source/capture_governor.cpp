@@ -0,0 +1,64 @@
+#include "capture_governor.h"
+#include <algorithm>
+
+// Converting every other frame only spares the main thread, the lower sizes and rates spare the camera thread too
+// 320x240 and 160x120 see as wide as 400x240 but taller, so the picture keeps its proportions once scaled to the screen
+const CaptureGovernor::Level CaptureGovernor::LEVELS[CaptureGovernor::LEVEL_AMOUNT] = {
+    {400, 240, 30, 1},
+    {400, 240, 30, 2},
+    {320, 240, 15, 1},
+    {160, 120, 15, 1},
+};
+
+CaptureGovernor::CaptureGovernor(u64 budgetTicks) : budgetTicks(budgetTicks)
+{
+    this->reset();
+}
+
+void CaptureGovernor::reset()
+{
+    this->current = 0;
+    this->upDelay = this->minUpDelay;
+    this->change(0);
+}
+
+void CaptureGovernor::change(u32 level)
+{
+    this->steppedUp = level < this->current;
+    this->current = level;
+    this->framesAtLevel = 0;
+    this->sampleCount = 0;
+}
+
+bool CaptureGovernor::update(u64 frameTicks)
+{
+    this->framesAtLevel++;
+    if(this->framesAtLevel <= this->settleFrames)
+        return false;
+
+    this->samples[this->sampleCount++ % WINDOW] = frameTicks;
+    if(this->sampleCount < WINDOW)
+        return false;
+
+    u32 overruns = std::count_if(this->samples, this->samples + WINDOW, [this](u64 sample) { return sample > this->budgetTicks; });
+    if(overruns >= this->overrunLimit && this->current + 1 < LEVEL_AMOUNT)
+    {
+        // The level above was just tried and couldn't hold, wait longer before the next attempt
+        if(this->steppedUp && this->framesAtLevel < this->upDelay)
+            this->upDelay = std::min(this->upDelay*2, this->maxUpDelay);
+        this->change(this->current + 1);
+        return true;
+    }
+
+    // Having held a level reached by stepping up, it's fine to try the next one sooner again
+    if(this->steppedUp && this->framesAtLevel == this->upDelay)
+        this->upDelay = std::max(this->upDelay/2, this->minUpDelay);
+
+    u64 slowest = *std::max_element(this->samples, this->samples + WINDOW);
+    if(this->current > 0 && this->framesAtLevel >= this->upDelay && slowest < this->budgetTicks*this->headroom)
+    {
+        this->change(this->current - 1);
+        return true;
+    }
+    return false;
+}
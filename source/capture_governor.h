@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.h"
+
+// Lowers the camera's quality when frames keep running over their budget, and raises it again once there is room
+// Stepping down takes a handful of slow frames, stepping up a long stretch of fast ones, and a step up that
+// has to be undone right away makes the next attempt wait twice as long
+class CaptureGovernor
+{
+    public:
+        typedef struct
+        {
+            u16 width, height;
+            u8 frameRate;
+            u8 convertInterval; // the camera texture is converted every this many frames
+        } Level;
+
+        static constexpr u32 LEVEL_AMOUNT = 4;
+        static const Level LEVELS[LEVEL_AMOUNT]; // best first
+
+        static constexpr u32 WINDOW = 30; // frames each decision looks at
+
+        CaptureGovernor(u64 budgetTicks);
+
+        // Takes the time one frame kept the CPU busy, returns whether the level changed
+        bool update(u64 frameTicks);
+        void reset();
+
+        u32 level() const { return this->current; }
+        const Level& settings() const { return LEVELS[this->current]; }
+
+        u32 overrunLimit = 6; // frames over budget in the window that make it step down
+        float headroom = 0.6f; // share of the budget every frame in the window has to stay under to step up
+        u32 settleFrames = 45; // frames ignored after a change, while the camera starts again
+        u32 minUpDelay = 150, maxUpDelay = 4800; // frames at a level before trying the one above
+
+    private:
+        void change(u32 level);
+
+        u64 budgetTicks;
+        u64 samples[WINDOW];
+        u32 sampleCount; // since the last change
+        u32 current;
+        u32 framesAtLevel;
+        u32 upDelay;
+        bool steppedUp; // the last change was a step up
+};
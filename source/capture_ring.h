@@ -0,0 +1,40 @@
+#pragma once
+
+#include "types.h"
+#include "triple_buffer.h"
+
+// The receiving side of a capture: every camera's picture is received straight into the frame the game will read,
+// a CAMERA_BUFFER_SIZE apart in the slot the triple buffer gives the producer, and the slot is published once they all landed
+// Holds no hardware state, the platform arms a receive into target(camera) and reports what became of it
+class CaptureRing
+{
+    public:
+        CaptureRing(TripleBuffer<u16>* frames, u32 cameras, u32 cameraStride) : frames(frames), cameras(cameras), cameraStride(cameraStride), landed(0) {}
+
+        // Where the camera's next picture has to be received, only valid until the next publish
+        u16* target(u32 camera) { return this->frames->writeBuffer() + camera*this->cameraStride; }
+
+        // The camera's picture landed in its target, returns the frame if that completed and published it, NULL otherwise
+        // Every target then moves to the next slot, so the receives have to be armed again
+        const u16* received(u32 camera)
+        {
+            this->landed |= 1 << camera;
+            if(this->landed != (1u << this->cameras) - 1)
+                return NULL;
+
+            const u16* frame = this->frames->writeBuffer();
+            this->landed = 0;
+            this->frames->publish();
+            return frame;
+        }
+
+        // A transfer failed, what landed of the frame is dropped and the targets stay on the same slot
+        void dropped() { this->landed = 0; }
+
+        bool pending() const { return this->landed != 0; }
+
+    private:
+        TripleBuffer<u16>* frames;
+        u32 cameras, cameraStride;
+        u32 landed; // cameras whose picture arrived in the current slot
+};
@@ -2,8 +2,6 @@
 
 #include <cstdio>
 
-#include <3ds.h>
-#include <citro3d.h>
-#include <citro2d.h>
+#include "platform.h"
 
 #define DEBUG(...) fprintf(stderr, __VA_ARGS__)
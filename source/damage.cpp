@@ -0,0 +1,82 @@
+#include "damage.h"
+#include "angular_grid.h"
+#include <cstdlib>
+
+DamageTable::DamageTable()
+{
+    for(u32 water = 0; water < MAX_WATERS; water++)
+    {
+        this->damages[water] = -1;
+        this->setWater(water, 0, 0, true);
+    }
+}
+
+void DamageTable::setWater(u32 water, u32 color, int damage, bool neutral)
+{
+    if(this->damages[water] == damage && this->neutral[water] == neutral && (neutral || this->colors[water] == color))
+        return;
+
+    this->colors[water] = color;
+    this->damages[water] = damage;
+    this->neutral[water] = neutral;
+
+    for(u32 channel = 0; channel < 3; channel++)
+    {
+        u8 waterPart = color >> (channel*8);
+        float scale = channel == 0 ? damage : 1.0f;
+        for(u32 paint = 0; paint < 256; paint++)
+            this->rows[water][channel][paint] = neutral ? scale : modifier(paint, waterPart)*scale;
+    }
+}
+
+float DamageTable::modifier(u8 paint, u8 water)
+{
+    if(abs(paint - water) <= TOLERANCE)
+        return 1.0f;
+    return paint > water ? (float)water/paint : (float)paint/water;
+}
+
+int DamageTable::hit(SplashPool& pool, const Beam& beam, const std::vector<SplashHandle>& candidates, std::vector<SplashHandle>& killed)
+{
+    const float* anglesX = pool.anglesX();
+    const float* anglesY = pool.anglesY();
+    const u8* flags = pool.flagBits();
+
+    // Which candidates the beam reaches, and the nearest of them to the aim
+    this->hits.clear();
+    float nearest = 0;
+    for(SplashHandle handle : candidates)
+    {
+        u32 index = pool.indexOf(handle);
+        if(index == SplashPool::INVALID_INDEX)
+            continue;
+
+        float center = flags[index] & SplashPool::FLAG_BOSS ? beam.center*2 : beam.center;
+        float dX = std::abs(angleDelta(anglesX[index], beam.tX));
+        float dY = std::abs(angleDelta(anglesY[index], beam.tY));
+        if(dX > center || dY > center)
+            continue;
+
+        if(beam.mode == BEAM_PIERCE)
+        {
+            this->hits.push_back(index);
+        }
+        else if(this->hits.empty() || dX*dX + dY*dY < nearest)
+        {
+            this->hits.assign(1, index);
+            nearest = dX*dX + dY*dY;
+        }
+    }
+
+    float* healths = pool.healths();
+    const u32* colors = pool.colors();
+    int damage = -1;
+    for(u32 index : this->hits)
+    {
+        damage = this->damage(beam.water, colors[index]);
+        healths[index] -= damage;
+        if(healths[index] <= 0)
+            killed.push_back(pool.handleAt(index));
+    }
+    return damage;
+}
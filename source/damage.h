@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.h"
+#include "splash_pool.h"
+#include <vector>
+
+// What a water does to each paint color, looked up instead of worked out on every hit
+// Each water has a row of modifiers per channel for every paint value, its damage folded into the red one,
+// and its rows are only built again when its color changes, which only the steal beam does
+class DamageTable
+{
+    public:
+        static constexpr u32 MAX_WATERS = 4;
+        static constexpr int TOLERANCE = 0x20; // how far apart paint and water channels can be before the hit weakens
+
+        typedef enum
+        {
+            BEAM_FIRST_HIT, // only the splash nearest to the aim
+            BEAM_PIERCE, // every splash in the beam
+        } BeamMode;
+
+        typedef struct
+        {
+            float tX, tY; // where the beam aims, the yaw not mattering like for isInCenter
+            float center; // degrees around the aim it reaches, twice that for bosses
+            u32 water;
+            BeamMode mode;
+        } Beam;
+
+        DamageTable();
+
+        // A neutral water, the clear one, does its full damage to every color
+        void setWater(u32 water, u32 color, int damage, bool neutral = false);
+
+        int damage(u32 water, u32 paint) const
+        {
+            const float (&rows)[3][256] = this->rows[water];
+            return (int)(rows[0][paint & 0xFF]*rows[1][(paint >> 8) & 0xFF]*rows[2][(paint >> 16) & 0xFF]);
+        }
+
+        // Paint and water channels more than TOLERANCE apart weaken the hit by their ratio
+        static float modifier(u8 paint, u8 water);
+
+        // Takes the beam's damage off the candidates it reaches in one sweep over the pool, adding those it kills to killed
+        // Nothing is removed from the pool, returns the damage of the last hit or -1 if nothing was hit
+        int hit(SplashPool& pool, const Beam& beam, const std::vector<SplashHandle>& candidates, std::vector<SplashHandle>& killed);
+
+    private:
+        float rows[MAX_WATERS][3][256];
+        u32 colors[MAX_WATERS];
+        int damages[MAX_WATERS];
+        bool neutral[MAX_WATERS];
+
+        std::vector<u32> hits; // scratch space for hit, indices in the pool
+};
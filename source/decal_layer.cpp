@@ -0,0 +1,113 @@
+#include "decal_layer.h"
+#include <algorithm>
+#include <cmath>
+
+// Paint fades out over the last quarter of its squared radius
+static constexpr float EDGE = 0.25f;
+
+static inline u32 texelRgba(u32 r, u32 g, u32 b, u32 a)
+{
+    return r << 24 | g << 16 | b << 8 | a;
+}
+
+DecalLayer::DecalLayer(u32* texture) : texels(texture)
+{
+    this->reset();
+}
+
+void DecalLayer::reset()
+{
+    std::fill(this->texels, this->texels + SIZE*SIZE, 0);
+    std::fill(this->dirtyBits, this->dirtyBits + TILE_COUNT/64, 0);
+    this->pendingCount = 0;
+    this->dirtyTileCount = 0;
+}
+
+u32 DecalLayer::texel(u32 x, u32 y) const
+{
+    u32 tile = (y/Swizzle::TILE_SIZE)*TILES + x/Swizzle::TILE_SIZE;
+    return this->texels[tile*Swizzle::TILE_PIXELS + Swizzle::mortonOffset(x % Swizzle::TILE_SIZE, y % Swizzle::TILE_SIZE)];
+}
+
+void DecalLayer::add(const Decal& decal)
+{
+    if(this->pendingCount == MAX_PENDING)
+        this->blend();
+
+    // The tiles under the decal's bounding box, at most every one of a row or column
+    auto range = [](float center, float radius, u32* first, u32* count) {
+        s32 low = std::floor((center - radius/PIXEL_ANGLE)/Swizzle::TILE_SIZE);
+        s32 high = std::floor((center + radius/PIXEL_ANGLE)/Swizzle::TILE_SIZE);
+        *first = ((low % (s32)TILES) + TILES) % TILES;
+        *count = std::min<u32>(high - low + 1, TILES);
+    };
+
+    Pending& pending = this->queue[this->pendingCount++];
+    pending.decal = decal;
+    range(column(decal.tY), decal.radius, &pending.firstTileX, &pending.tilesX);
+    range(row(decal.tX), decal.radius, &pending.firstTileY, &pending.tilesY);
+
+    for(u32 j = 0; j < pending.tilesY; j++)
+    {
+        for(u32 i = 0; i < pending.tilesX; i++)
+        {
+            u32 tile = ((pending.firstTileY + j) % TILES)*TILES + (pending.firstTileX + i) % TILES;
+            u64 bit = 1ull << (tile % 64);
+            if(this->dirtyBits[tile/64] & bit)
+                continue;
+            this->dirtyBits[tile/64] |= bit;
+            this->dirtyTiles[this->dirtyTileCount++] = tile;
+        }
+    }
+}
+
+bool DecalLayer::touches(const Pending& pending, u32 tileX, u32 tileY)
+{
+    return (tileX + TILES - pending.firstTileX) % TILES < pending.tilesX && (tileY + TILES - pending.firstTileY) % TILES < pending.tilesY;
+}
+
+// Each dirty tile goes through the queue once, so decals overlapping in a tile are blended in order
+u32 DecalLayer::blend()
+{
+    u32 count = this->dirtyTileCount;
+    for(u32 i = 0; i < count; i++)
+    {
+        u32 tile = this->dirtyTiles[i];
+        u32 tileX = tile % TILES, tileY = tile / TILES;
+        for(u32 j = 0; j < this->pendingCount; j++)
+            if(touches(this->queue[j], tileX, tileY))
+                this->blendTile(tileX, tileY, this->queue[j].decal);
+        this->dirtyBits[tile/64] &= ~(1ull << (tile % 64));
+    }
+    this->dirtyTileCount = 0;
+    this->pendingCount = 0;
+    return count;
+}
+
+void DecalLayer::blendTile(u32 tileX, u32 tileY, const Decal& decal)
+{
+    u32 r = decal.color & 0xFF, g = (decal.color >> 8) & 0xFF, b = (decal.color >> 16) & 0xFF, alpha = decal.color >> 24;
+    float radiusSquared = decal.radius*decal.radius;
+    u32* tile = this->texels + (tileY*TILES + tileX)*Swizzle::TILE_PIXELS;
+    for(u32 y = 0; y < Swizzle::TILE_SIZE; y++)
+    {
+        float down = FastMath::wrapDegrees(-180.0f + (tileY*Swizzle::TILE_SIZE + y + 0.5f)*PIXEL_ANGLE - decal.tX);
+        for(u32 x = 0; x < Swizzle::TILE_SIZE; x++)
+        {
+            float across = FastMath::wrapDegrees(-180.0f + (tileX*Swizzle::TILE_SIZE + x + 0.5f)*PIXEL_ANGLE - decal.tY);
+            float left = 1.0f - (down*down + across*across)/radiusSquared;
+            if(left <= 0.0f)
+                continue;
+
+            // Over what is already there, the texture's colors not being multiplied by their alpha
+            u32 a = alpha*std::min(left/EDGE, 1.0f);
+            if(a == 0)
+                continue;
+            u32& target = tile[Swizzle::mortonOffset(x, y)];
+            u32 below = (target & 0xFF)*(255 - a)/255;
+            u32 total = a + below;
+            auto mix = [a, below, total](u32 top, u32 old) { return (top*a + old*below)/total; };
+            target = texelRgba(mix(r, target >> 24), mix(g, (target >> 16) & 0xFF), mix(b, (target >> 8) & 0xFF), total);
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common.h"
+#include "swizzle.h"
+#include "fast_math.h"
+
+// Paint left where splashes died, in a SIZE*SIZE RGBA8 texture over the game's tY (across) and tX (down) angles like the panorama,
+// written straight in the GPU's tiled layout
+// Decals are queued as they're made, and blended once per frame into only the 8x8 tiles they touch, which are then the dirty ones,
+// so a frame costs the same however much paint is already down
+class DecalLayer
+{
+    public:
+        static constexpr u32 SIZE = 256;
+        static constexpr u32 TILES = SIZE/Swizzle::TILE_SIZE; // per side
+        static constexpr u32 TILE_COUNT = TILES*TILES;
+        static constexpr float PIXEL_ANGLE = 360.0f/SIZE;
+        static constexpr u32 MAX_PENDING = 64;
+
+        typedef struct
+        {
+            float tX, tY;
+            float radius; // in degrees
+            u32 color; // color32, its alpha being the paint's at the center
+        } Decal;
+
+        // texture is SIZE*SIZE texels, cleared here and then only written by blend
+        DecalLayer(u32* texture);
+
+        // Once MAX_PENDING decals are queued, they're blended right away to make room
+        void add(const Decal& decal);
+        // Blends the queued decals in the order they were added, returns how many tiles changed
+        u32 blend();
+        void reset();
+
+        u32 pending() const { return this->pendingCount; }
+        u32 dirtyCount() const { return this->dirtyTileCount; }
+        bool dirty(u32 tileX, u32 tileY) const { u32 tile = tileY*TILES + tileX; return this->dirtyBits[tile/64] >> (tile%64) & 1; }
+        u32* texture() const { return this->texels; }
+
+        // Where angles land in the texture, in texels
+        static float column(float tY) { return (FastMath::wrapDegrees(tY) + 180.0f)/PIXEL_ANGLE; }
+        static float row(float tX) { return (FastMath::wrapDegrees(tX) + 180.0f)/PIXEL_ANGLE; }
+        // The texel at x, y, as the GPU reads it
+        u32 texel(u32 x, u32 y) const;
+
+    private:
+        // A decal and the tiles it touches, the ranges going round the texture's edges
+        typedef struct
+        {
+            Decal decal;
+            u32 firstTileX, tilesX;
+            u32 firstTileY, tilesY;
+        } Pending;
+
+        static bool touches(const Pending& pending, u32 tileX, u32 tileY);
+        void blendTile(u32 tileX, u32 tileY, const Decal& decal);
+
+        u32* texels;
+        Pending queue[MAX_PENDING];
+        u32 pendingCount;
+        u64 dirtyBits[TILE_COUNT/64];
+        u16 dirtyTiles[TILE_COUNT]; // in the order they became dirty
+        u32 dirtyTileCount;
+};
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "types.h"
+#include <array>
+#include <cmath>
+#include <type_traits>
+
+// Single precision trigonometry in degrees, the game never needs radians or doubles
+// The implementation is picked at build time with -DFAST_MATH_BACKEND=...
+#define FAST_MATH_LIBM 0  // sinf/atan2f from libm
+#define FAST_MATH_LUT 1   // float lookup tables with linear interpolation
+#define FAST_MATH_FIXED 2 // Q16 fixed point lookup tables, float only to convert in and out
+
+#ifndef FAST_MATH_BACKEND
+#define FAST_MATH_BACKEND FAST_MATH_LUT
+#endif
+
+namespace FastMath
+{
+    constexpr float PI = 3.14159265358979f;
+    constexpr float DEGREES_PER_RADIAN = 180.0f/PI;
+
+    // Wraps an angle to [-180, 180), without going through fmod
+    inline float wrapDegrees(float x)
+    {
+        float wrapped = x - 360.0f*std::floor((x + 180.0f)*(1.0f/360.0f));
+        // Big angles can round to just past either end
+        if(wrapped < -180.0f)
+            return wrapped + 360.0f;
+        return wrapped >= 180.0f ? wrapped - 360.0f : wrapped;
+    }
+
+    namespace Tables
+    {
+        constexpr u32 SINE_BITS = 8;
+        constexpr u32 SINE_SIZE = 1 << SINE_BITS; // entries per full turn
+        constexpr u32 ATAN_SIZE = 256; // entries over [0, 1]
+
+        // Taylor series, only used to fill the tables at compile time
+        constexpr double taylorSine(double x)
+        {
+            while(x > 3.14159265358979323846)
+                x -= 2*3.14159265358979323846;
+            while(x < -3.14159265358979323846)
+                x += 2*3.14159265358979323846;
+            double term = x, sum = x;
+            for(int n = 1; n < 20; n++)
+            {
+                term *= -x*x/((2*n)*(2*n+1));
+                sum += term;
+            }
+            return sum;
+        }
+
+        constexpr double taylorArctangent(double x) // |x| <= 1
+        {
+            // atan(x) = 2*atan(x/(1+sqrt(1+x^2))) brings the argument under 0.42, where the series converges quickly
+            double s = 1 + x*x, root = s;
+            for(int i = 0; i < 30; i++)
+                root = (root + s/root)/2;
+            x /= 1 + root;
+            double term = x, sum = x;
+            for(int n = 1; n < 40; n++)
+            {
+                term *= -x*x;
+                sum += term/(2*n+1);
+            }
+            return 2*sum;
+        }
+
+        // One guard entry at the end so interpolation never has to wrap
+        template<typename T, u32 size, typename F>
+        constexpr std::array<T, size+1> makeTable(F function, double scale)
+        {
+            std::array<T, size+1> table{};
+            for(u32 i = 0; i <= size; i++)
+            {
+                double value = function(i)*scale;
+                if constexpr(std::is_floating_point_v<T>)
+                    table[i] = value;
+                else
+                    table[i] = value < 0 ? value - 0.5 : value + 0.5;
+            }
+            return table;
+        }
+
+        constexpr auto sineFloat = makeTable<float, SINE_SIZE>([](u32 i){ return taylorSine(i*2*3.14159265358979323846/SINE_SIZE); }, 1.0);
+        constexpr auto arctangentFloat = makeTable<float, ATAN_SIZE>([](u32 i){ return taylorArctangent((double)i/ATAN_SIZE); }, 180/3.14159265358979323846);
+        constexpr auto sineQ16 = makeTable<s32, SINE_SIZE>([](u32 i){ return taylorSine(i*2*3.14159265358979323846/SINE_SIZE); }, 65536.0);
+        constexpr auto arctangentQ16 = makeTable<s32, ATAN_SIZE>([](u32 i){ return taylorArctangent((double)i/ATAN_SIZE); }, 180/3.14159265358979323846*65536.0);
+    }
+
+    // Degrees to a 16 bit fraction of a turn, where 65536 is 360 degrees and wrapping is free
+    inline u32 degreesToPhase(float degrees)
+    {
+        return (u32)(s32)std::lround(degrees*(65536.0f/360.0f)) & 0xFFFF;
+    }
+
+    // Every backend is built, so that they can be checked and timed against each other, the game only calls the one picked
+    namespace Libm
+    {
+        inline float sinDegrees(float degrees)
+        {
+            return std::sin(degrees/DEGREES_PER_RADIAN);
+        }
+
+        inline float atan2Degrees(float y, float x)
+        {
+            return std::atan2(y, x)*DEGREES_PER_RADIAN;
+        }
+    }
+
+    // The tables only cover the first octant, lookup gives the angle of a ratio in [0, 1]
+    template<typename F>
+    inline float atan2FromOctant(float y, float x, F lookup)
+    {
+        float absY = std::abs(y), absX = std::abs(x);
+        if(absX == 0 && absY == 0)
+            return 0;
+
+        // Look up the angle of the smaller over the larger one, which is always in [0, 1]
+        bool swapped = absY > absX;
+        float angle = lookup(swapped ? absX/absY : absY/absX);
+        if(swapped)
+            angle = 90.0f - angle;
+        if(x < 0)
+            angle = 180.0f - angle;
+        return y < 0 ? -angle : angle;
+    }
+
+    namespace Lut
+    {
+        inline float sinDegrees(float degrees)
+        {
+            float position = wrapDegrees(degrees)*(Tables::SINE_SIZE/360.0f);
+            if(position < 0)
+                position += Tables::SINE_SIZE;
+            u32 whole = (u32)position;
+            float fraction = position - whole;
+            u32 index = whole & (Tables::SINE_SIZE - 1); // rounding can land exactly on SINE_SIZE
+            return Tables::sineFloat[index] + (Tables::sineFloat[index+1] - Tables::sineFloat[index])*fraction;
+        }
+
+        inline float atan2Degrees(float y, float x)
+        {
+            return atan2FromOctant(y, x, [](float ratio) {
+                float position = ratio*Tables::ATAN_SIZE;
+                u32 index = (u32)position;
+                if(index == Tables::ATAN_SIZE)
+                    index--;
+                return Tables::arctangentFloat[index] + (Tables::arctangentFloat[index+1] - Tables::arctangentFloat[index])*(position - index);
+            });
+        }
+    }
+
+    namespace Fixed
+    {
+        inline float sinDegrees(float degrees)
+        {
+            constexpr u32 FRACTION_BITS = 16 - Tables::SINE_BITS;
+            u32 phase = degreesToPhase(degrees);
+            u32 index = phase >> FRACTION_BITS;
+            s32 fraction = phase & ((1 << FRACTION_BITS) - 1);
+            s32 value = Tables::sineQ16[index] + (((Tables::sineQ16[index+1] - Tables::sineQ16[index])*fraction) >> FRACTION_BITS);
+            return value*(1.0f/65536.0f);
+        }
+
+        inline float atan2Degrees(float y, float x)
+        {
+            return atan2FromOctant(y, x, [](float ratio) {
+                u32 position = (u32)(ratio*(Tables::ATAN_SIZE << 16)); // Q16 table position
+                u32 index = position >> 16;
+                if(index == Tables::ATAN_SIZE)
+                    index--;
+                s32 fraction = (position - (index << 16)) >> 1; // Q15 so the product fits in 32 bits
+                s32 value = Tables::arctangentQ16[index] + (((Tables::arctangentQ16[index+1] - Tables::arctangentQ16[index])*fraction) >> 15);
+                return value*(1.0f/65536.0f);
+            });
+        }
+    }
+
+#if FAST_MATH_BACKEND == FAST_MATH_LIBM
+    namespace Backend = Libm;
+#elif FAST_MATH_BACKEND == FAST_MATH_LUT
+    namespace Backend = Lut;
+#else
+    namespace Backend = Fixed;
+#endif
+
+    inline float sinDegrees(float degrees)
+    {
+        return Backend::sinDegrees(degrees);
+    }
+
+    inline float cosDegrees(float degrees)
+    {
+        return sinDegrees(degrees + 90.0f);
+    }
+
+    // Same quadrant handling as atan2, result in (-180, 180]
+    inline float atan2Degrees(float y, float x)
+    {
+        return Backend::atan2Degrees(y, x);
+    }
+}
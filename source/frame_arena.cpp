@@ -0,0 +1,38 @@
+#include "frame_arena.h"
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity, Memory::Tag tag) : size(capacity), offset(0), highWater(0), tag(tag)
+{
+    this->memory = (u8*)::operator new(capacity);
+    Memory::account(tag, capacity);
+}
+
+FrameArena::~FrameArena()
+{
+    ::operator delete(this->memory);
+    Memory::release(this->tag, this->size);
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment)
+{
+    size_t current = this->offset.load(std::memory_order_relaxed);
+    size_t start, end;
+    do
+    {
+        start = (current + alignment - 1) & ~(alignment - 1);
+        end = start + size;
+        if(end > this->size)
+        {
+            Memory::fail(this->tag, end, this->size);
+            return NULL;
+        }
+    }
+    while(!this->offset.compare_exchange_weak(current, end, std::memory_order_relaxed));
+    return this->memory + start;
+}
+
+void FrameArena::reset()
+{
+    this->highWater = std::max(this->highWater, this->used());
+    this->offset.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "types.h"
+#include "memory.h"
+#include <atomic>
+#include <cstddef>
+
+// Memory for what only lasts a frame, like the quads of the splashes in view: allocating just moves an offset
+// forward in one block taken up front, and reset hands everything back at once
+// Threads can allocate at the same time, but reset must only be called while none does
+class FrameArena
+{
+    public:
+        FrameArena(size_t capacity, Memory::Tag tag = Memory::TAG_FRAME);
+        ~FrameArena();
+
+        // NULL once the arena is full, which is reported as its tag going over budget
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+        template<typename T>
+        T* allocate(size_t count)
+        {
+            return (T*)this->allocate(count*sizeof(T), alignof(T));
+        }
+
+        void reset();
+
+        size_t used() const { return this->offset.load(std::memory_order_relaxed); }
+        size_t peak() const { return this->highWater > this->used() ? this->highWater : this->used(); } // the most a frame used
+        size_t capacity() const { return this->size; }
+
+    private:
+        u8* memory;
+        size_t size;
+        std::atomic<size_t> offset;
+        size_t highWater;
+        Memory::Tag tag;
+};
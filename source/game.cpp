@@ -1,12 +1,14 @@
 #include "game.h"
 #include "camera.h"
 #include "sprites.h"
+#include "fast_math.h"
+#include "profiler.h"
 #include <cmath>
+#include <algorithm>
+#include <sys/stat.h>
 
-//http://www.pieter-jan.com/node/11
-#define dt (double)(1.0f/30.0f)
-
-#define GYROSCOPE_SENSITIVITY (double)14.375
+#define GYROSCOPE_SENSITIVITY 14.375f // raw units per degree per second
+#define ACCELEROMETER_SENSITIVITY 16384.0f // raw units per G, -2 to 2 G at 16 bits
 
 typedef enum {
     DEADZONE_PITCH = 10,
@@ -14,484 +16,953 @@ typedef enum {
     DEADZONE_ROLL = 25,
 } GyroDeadzone;
 
-void ComplementaryFilter(accelVector vector, angularRate rate, double *pitch, double *roll, double *yaw)
+// Remaps the raw readings to the accelerometer's axes: rate.x turns around x, rate.z around y and rate.y around z
+static Orientation::Sample makeImuSample(const Recording::Frame& frame)
 {
+    struct { s16 x, z, y; } rate = {frame.gyro[0], frame.gyro[1], frame.gyro[2]};
+
     if(abs(rate.x) < DEADZONE_PITCH)
         rate.x = 0;
     if(abs(rate.y) < DEADZONE_YAW)
-        rate.x = 0;
+        rate.y = 0;
     if(abs(rate.z) < DEADZONE_ROLL)
-        rate.x = 0;
-
-    // Integrate the gyroscope data -> int(angularSpeed) = angle
-    *pitch += ((double)rate.x / GYROSCOPE_SENSITIVITY) * dt; // Angle around the X-axis
-    *roll -= ((double)rate.z / GYROSCOPE_SENSITIVITY) * dt;  // Angle around the Z-axis
-    // *yaw -= ((double)rate.y / GYROSCOPE_SENSITIVITY) * dt;   // Angle around the Y-axis
-
-    // Compensate for drift with accelerometer data if !bullshit
-    // Sensitivity = -2 to 2 G at 16Bit -> 2G = 32768 && 0.5G = 8192
-    int forceMagnitudeApprox = abs(vector.x) + abs(vector.z) + abs(vector.y);
-    if (forceMagnitudeApprox > 8192 && forceMagnitudeApprox < 32768)
-    {
-        // Turning around the X axis results in a vector on the Y-axis
-        double pitchAcc = atan2((double)vector.y, (double)vector.z) * 180 / M_PI;
-        *pitch = *pitch * 0.98 + pitchAcc * 0.02;
-
-        // Turning around the Y axis results in a vector on the X-axis
-        double rollAcc = atan2((double)vector.x, (double)vector.z) * 180 / M_PI;
-        *roll = *roll * 0.98 + rollAcc * 0.02;
-    }
+        rate.z = 0;
+
+    Orientation::Sample sample;
+    sample.tick = frame.tick;
+    sample.gyro[0] = rate.x/GYROSCOPE_SENSITIVITY;
+    sample.gyro[1] = rate.z/GYROSCOPE_SENSITIVITY;
+    sample.gyro[2] = rate.y/GYROSCOPE_SENSITIVITY;
+    sample.accel[0] = frame.accel[0]/ACCELEROMETER_SENSITIVITY;
+    sample.accel[1] = frame.accel[1]/ACCELEROMETER_SENSITIVITY;
+    sample.accel[2] = frame.accel[2]/ACCELEROMETER_SENSITIVITY;
+    return sample;
 }
 
-static double constrainAngle(double x)
+static inline u32 randomColor(Random& random)
 {
-    x = fmod(x + 180, 360);
-    if (x < 0)
-        x += 360;
-    return x - 180;
+    u32 randMax = 0x100-Game::colorBeforeDamageLower*2;
+    u8 r = Game::colorBeforeDamageLower + random.below(randMax);
+    u8 g = Game::colorBeforeDamageLower + random.below(randMax);
+    u8 b = Game::colorBeforeDamageLower + random.below(randMax);
+    return Platform::color32(r, g, b, 0xFF);
 }
 
-static inline u32 randomColor()
+// Colors taken from the camera are pulled into the range water can still damage
+static inline u32 paletteColor(u32 color)
 {
-    int randMax = 0x100-Game::colorBeforeDamageLower*2;
-    return C2D_Color32(Game::colorBeforeDamageLower + rand() % randMax, Game::colorBeforeDamageLower + rand() % randMax, Game::colorBeforeDamageLower + rand() % randMax, 0xFF);
-}
-
-static double calculateModifier(u8 paintPart, u8 waterPart)
-{
-    if(abs(paintPart-waterPart) > Game::colorBeforeDamageLower)
-    {
-        double part = 1.0f;
-        if(paintPart > waterPart)
-        {
-            part = (double)waterPart/(double)paintPart;
-        }
-        else
-        {
-            part = (double)paintPart/(double)waterPart;
-        }
-        return part;
-    }
-    else
-        return 1.0f;
+    auto clamp = [](u32 part) { return (u8)std::clamp<u32>(part & 0xFF, Game::colorBeforeDamageLower, 0xFF-Game::colorBeforeDamageLower); };
+    return Platform::color32(clamp(color), clamp(color >> 8), clamp(color >> 16), 0xFF);
 }
 
 namespace Game
 {
-    static C2D_SpriteSheet spritesheet;
-    static C2D_Sprite paintSprite;
-    static C2D_Sprite beamSprites[BEAM_TYPE_AMOUNT];
+    static constexpr u32 clearWaterColor = Platform::color32(0x00, 0x94, 0xFF, 0xFF);
+    static constexpr u32 fakeWhiteColor = Platform::color32(0xFF-colorBeforeDamageLower, 0xFF-colorBeforeDamageLower, 0xFF-colorBeforeDamageLower, 0xFF);
+    static constexpr u32 fakeBlackColor = Platform::color32(colorBeforeDamageLower, colorBeforeDamageLower, colorBeforeDamageLower, 0xFF);
 
-    static constexpr u32 clearWaterColor = C2D_Color32(0x00, 0x94, 0xFF, 0xFF);
-    static constexpr u32 fakeWhiteColor = C2D_Color32(0xFF-colorBeforeDamageLower, 0xFF-colorBeforeDamageLower, 0xFF-colorBeforeDamageLower, 0xFF);
-    static constexpr u32 fakeBlackColor = C2D_Color32(colorBeforeDamageLower, colorBeforeDamageLower, colorBeforeDamageLower, 0xFF);
+    static constexpr WaterProperty clearWater = {clearWaterColor, 1};
+    static constexpr WaterProperty whitewater = {fakeWhiteColor, 5};
+    static constexpr WaterProperty blackWater = {fakeBlackColor, 5};
+    // What every game starts with, stolen colors only last until it ends
+    static constexpr WaterTypes defaultWaters = {clearWater, whitewater, blackWater};
 
-    static WaterProperty clearWater = {clearWaterColor, 1};
-    static WaterProperty whitewater = {fakeWhiteColor, 5};
-    static WaterProperty blackWater = {fakeBlackColor, 5};
-    static auto waterProperties = std::array{clearWater, whitewater, blackWater};
+    static_assert(Recording::PALETTE_COLORS == CAMERA_PALETTE_COLORS);
+    static_assert(DamageTable::TOLERANCE == colorBeforeDamageLower);
+    static_assert(WATER_TYPE_AMOUNT <= DamageTable::MAX_WATERS);
 
     static constexpr int POINTS_FOR_BOSS = 3;
     static constexpr int KILLS_TO_BOSS = 10;
     static constexpr int SECONDS_TO_SPAWN = 10;
-
-    static constexpr double angleVisible = 67.5f;
-    static constexpr double angleCenter = 8.0f;
-    static constexpr double BASE_HEALTH = 50;
-    static constexpr double BOSS_HEALTH_MODIFIER = 10;
+    static constexpr u64 SCHEDULE_RATE = 60; // timer wheel ticks per second
+
+    // The rules run in fixed steps of the frames' time, so the game goes as fast whatever the frame rate
+    static constexpr u64 STEP_RATE = 30; // steps per second, what the rules were tuned for
+    static constexpr u64 STEP_TICKS = Platform::TICKS_PER_SECOND/STEP_RATE;
+    static constexpr u64 MAX_STEPS = 8; // per frame
+    static constexpr float SENSOR_RATE = 120; // the orientation is integrated at least this often, between frames too
+
+    // Room for everything drawn that only lasts the frame, like a quad per splash in view
+    static constexpr size_t FRAME_ARENA_BYTES = 64*1024;
+
+    // Work a frame can take before the camera has to give some up, the game aims at 30 frames per second
+    static constexpr u64 FRAME_BUDGET_TICKS = Platform::TICKS_PER_SECOND/30;
+
+    // Stitching into the panorama gives up its tiles left for later frames after this long
+    static constexpr u64 PANORAMA_BUDGET_TICKS = Platform::TICKS_PER_SECOND/1000;
+    static constexpr float MINIMAP_SIZE = 96.0f;
+
+    // Put a log at REPLAY_PATH to play it back instead of reading the console, every live session is saved to RECORDING_PATH
+    // A replay can also be passed as the first argument
+    static constexpr const char* RECORDING_NAME = "last.bin";
+    static constexpr const char* REPLAY_NAME = "replay.bin";
+    // Scripted spawns are read from WAVES_NAME, or the second argument, see Waves
+    static constexpr const char* WAVES_NAME = "waves.txt";
+
+    static constexpr float angleVisible = 67.5f;
+    static constexpr float DECAL_RADIUS = 4.0f; // in degrees, twice that for bosses
+    // Splashes are drawn sin(angle) half screens from the center, which near it is this many degrees per half screen
+    static constexpr float DECAL_HALF_VIEW = FastMath::DEGREES_PER_RADIAN;
+    static constexpr float angleCenter = 8.0f;
+    // Whether the water beam goes through every splash in its center or stops at the nearest
+    static constexpr DamageTable::BeamMode BEAM_MODE = DamageTable::BEAM_PIERCE;
+    // How far out of the screen things look in 3D, see Stereo::eyeOffset
+    static constexpr float splashPopOut = 0.5f;
+    static constexpr float hudPopOut = 1.0f;
+    static constexpr float BASE_HEALTH = 50;
+    static constexpr float BOSS_HEALTH_MODIFIER = 10;
+
+    // Order of the quads in the HUD draw list, each water type has its color then its slot
+    static constexpr size_t HIT_COUNTER_DIGITS = 8;
+    enum HudQuad
+    {
+        HUD_SELECTED_COLOR,
+        HUD_GUN,
+        HUD_WATER_LEVEL,
+        HUD_WATER_OVERLAY,
+        HUD_COUNTER_OVERLAY,
+        HUD_DIGITS,
+        HUD_WATER_TYPES = HUD_DIGITS + HIT_COUNTER_DIGITS,
+
+        HUD_QUAD_AMOUNT = HUD_WATER_TYPES + 2*WATER_TYPE_AMOUNT
+    };
 
     enum WaterInfo
     {
         WATER_LEVEL_MAX = 100,
-        FRAMES_TO_RELOAD = 3,
-        FRAMES_TO_SPEND = 2,
+        STEPS_TO_RELOAD = 3,
+        STEPS_TO_SPEND = 2,
     };
 
-    PaintSplash::PaintSplash(bool boss)
+    PaintSplash::PaintSplash(SplashPool& pool, SplashHandle handle) : pool(pool), index(pool.indexOf(handle)) {}
+
+    SplashHandle PaintSplash::spawn(SplashPool& pool, Random& random, bool boss, const WaterTypes& waters, const u32* palette)
     {
-        double (*random_deg_angle)() = [](){ return (rand() % 360) - 180.0; };
-        this->tX = random_deg_angle();
-        this->tY = random_deg_angle();
-        this->tZ = 0;
+        float tX = random.below(360) - 180.0f;
+        float tY = random.below(360) - 180.0f;
+        return spawnAt(pool, random, tX, tY, boss, waters, palette);
+    }
 
-        this->boss = boss;
+    SplashHandle PaintSplash::spawnAt(SplashPool& pool, Random& random, float tX, float tY, bool boss, const WaterTypes& waters, const u32* palette)
+    {
         if(boss)
         {
-            size_t color = rand() % waterProperties.size();
-            this->color = waterProperties[color].color;
-            this->health = BASE_HEALTH*BOSS_HEALTH_MODIFIER;
+            size_t color = random.below(WATER_TYPE_AMOUNT);
+            return pool.add(tX, tY, 0, BASE_HEALTH*BOSS_HEALTH_MODIFIER, waters[color].color, SplashPool::FLAG_BOSS);
         }
         else
         {
-            this->color = randomColor();
-            this->health = BASE_HEALTH;
+            u32 color = palette ? palette[random.below(Recording::PALETTE_COLORS)] : 0;
+            return pool.add(tX, tY, 0, BASE_HEALTH, color ? paletteColor(color) : randomColor(random), 0);
         }
     }
 
-    PaintSplash::PaintSplash(double tX, double tY, double tZ)
+    SplashHandle PaintSplash::spawn(SplashPool& pool, Random& random, float tX, float tY, float tZ)
     {
-        double (*dispersion)(double) = [](double cur) { return cur - (rand() % 10) + (rand() % 10);};
-        this->tX = dispersion(tX);
-        this->tY = dispersion(tY);
-        this->tZ = dispersion(tZ);
-        this->color = randomColor();
-        this->health = BASE_HEALTH;
-        this->boss = false;
+        auto dispersion = [&random](float cur) { float down = random.below(10); return cur - down + random.below(10); };
+        float x = dispersion(tX), y = dispersion(tY), z = dispersion(tZ);
+        return pool.add(x, y, z, BASE_HEALTH, randomColor(random), 0);
     }
 
-    bool PaintSplash::isVisible(double tX, double tY, double tZ)
+    bool PaintSplash::isVisible(float tX, float tY)
     {
-        if(this->tX - angleVisible <= tX && tX <= this->tX + angleVisible)
-            if(this->tY - angleVisible <= tY && tY <= this->tY + angleVisible)
-                if(this->tZ - angleVisible <= tZ && tZ <= this->tZ + angleVisible)
-                    return true;
+        if(std::abs(angleDelta(this->pool.anglesX()[this->index], tX)) <= angleVisible)
+            if(std::abs(angleDelta(this->pool.anglesY()[this->index], tY)) <= angleVisible)
+                return true;
         return false;
     }
 
-    void PaintSplash::draw(double tX, double tY, double tZ)
+    Platform::Quad PaintSplash::quad(float tX, float tY)
     {
-        double x_orig = 200;
-        double y_orig = 120;
+        float x_orig = 200;
+        float y_orig = 120;
 
-        double y = 1.0f;
-        double x = 1.0f;
+        float y = 1.0f;
+        float x = 1.0f;
 
-        double y_coeff = 1.0f;
-        double x_coeff = 1.0f;
+        float y_coeff = 1.0f;
+        float x_coeff = 1.0f;
 
-        y = sin(C3D_AngleFromDegrees(this->tX-tX))*y_coeff;
-        x = sin(C3D_AngleFromDegrees(this->tY-tY))*x_coeff;
+        y = FastMath::sinDegrees(this->pool.anglesX()[this->index]-tX)*y_coeff;
+        x = FastMath::sinDegrees(this->pool.anglesY()[this->index]-tY)*x_coeff;
 
+        bool boss = this->isBoss();
+        float health = this->pool.healths()[this->index];
         u8 alpha = 127;
-        if(this->boss)
+        float scale = 1.0f;
+        if(boss)
         {
-            C2D_SpriteSetPos(&paintSprite, (x+1.0f)*x_orig - 32, (y+1.0f)*y_orig - 32);
-            C2D_SpriteSetScale(&paintSprite, 2.0f, 2.0f);
-            alpha += this->health*128/(BASE_HEALTH*BOSS_HEALTH_MODIFIER);
+            scale = 2.0f;
+            alpha += health*128/(BASE_HEALTH*BOSS_HEALTH_MODIFIER);
         }
         else
         {
-            C2D_SpriteSetPos(&paintSprite, (x+1.0f)*x_orig - 16, (y+1.0f)*y_orig - 16);
-            alpha += this->health*128/BASE_HEALTH;
+            alpha += health*128/BASE_HEALTH;
         }
 
-        u32 color = (this->color & 0x00FFFFFF) | (alpha << 24);
-        C2D_ImageTint tint;
-        C2D_PlainImageTint(&tint, color, 1.0f);
-        C2D_DrawSpriteTinted(&paintSprite, &tint);
-
-        if(this->boss)
-            C2D_SpriteSetScale(&paintSprite, 1.0f, 1.0f);
+        u32 color = (this->getColor() & 0x00FFFFFF) | (alpha << 24);
+        return Platform::Quad{sprites_paint_idx, (x+1.0f)*x_orig - 16*scale, (y+1.0f)*y_orig - 16*scale, 0.55f, 0, 0, scale, color, true};
     }
 
-    bool PaintSplash::isInCenter(double tX, double tY, double tZ)
+    bool PaintSplash::isInCenter(float tX, float tY)
     {
-        double actualAngleCenter = this->boss ? angleCenter*2 : angleCenter;
-        if(this->tX - actualAngleCenter <= tX && tX <= this->tX + actualAngleCenter)
-            if(this->tY - actualAngleCenter <= tY && tY <= this->tY + actualAngleCenter)
-                if(this->tZ - actualAngleCenter <= tZ && tZ <= this->tZ + actualAngleCenter)
-                    return true;
+        float actualAngleCenter = this->isBoss() ? angleCenter*2 : angleCenter;
+        if(std::abs(angleDelta(this->pool.anglesX()[this->index], tX)) <= actualAngleCenter)
+            if(std::abs(angleDelta(this->pool.anglesY()[this->index], tY)) <= actualAngleCenter)
+                return true;
         return false;
     }
 
-    bool PaintSplash::hit(const WaterProperty& water, int* damage)
+    bool PaintSplash::isBoss()
     {
-        double modifier = 1.0f;
-        if(water.color != clearWaterColor)
-        {
-            u8 thisR = this->color >> 24 & 0xFF;
-            u8 thisG = this->color >> 16 & 0xFF;
-            u8 thisB = this->color >> 8 & 0xFF;
+        return this->pool.flagBits()[this->index] & SplashPool::FLAG_BOSS;
+    }
 
-            u8 waterR = water.color >> 24 & 0xFF;
-            u8 waterG = water.color >> 16 & 0xFF;
-            u8 waterB = water.color >> 8 & 0xFF;
+    void PaintSplash::getAngles(float* tX, float* tY,float* tZ)
+    {
+        *tX = this->pool.anglesX()[this->index];
+        *tY = this->pool.anglesY()[this->index];
+        *tZ = this->pool.anglesZ()[this->index];
+    }
 
-            double modifierR = calculateModifier(thisR, waterR);
-            double modifierG = calculateModifier(thisG, waterG);
-            double modifierB = calculateModifier(thisB, waterB);
+    u32 PaintSplash::getColor()
+    {
+        return this->pool.colors()[this->index];
+    }
 
-            modifier *= modifierR*modifierG*modifierB;
+    // Only the system comes up before the job system, which then runs the other tasks as soon as what they need is up,
+    // so the camera starts, the sprites load and the text is parsed at the same time
+    Game::Game(int argc, char* argv[]) : orientation(Platform::TICKS_PER_SECOND), frameArena(FRAME_ARENA_BYTES), governor(FRAME_BUDGET_TICKS)
+    {
+        StartupArguments arguments = {this, argc, argv};
+        this->startup.runNow("system", initSystemTask, &arguments);
+        this->jobs = Memory::create<JobSystem>(Memory::TAG_GAME, Platform::coreCount() - 1);
+
+        this->stereo = false;
+        this->hardwareConversion = false;
+        this->conversionFailed = false;
+        this->cameraShown = false;
+        this->frameWaitTicks = 0;
+        this->drawnFrames = 0;
+        this->waters = defaultWaters;
+        for(u32 eye = 0; eye < Stereo::EYE_AMOUNT; eye++)
+        {
+            for(u32 i = 0; i < CAMERA_JOBS; i++)
+            {
+                u32 first = i*CAMERA_TILE_ROWS/CAMERA_JOBS, end = (i+1)*CAMERA_TILE_ROWS/CAMERA_JOBS;
+                this->cameraBands[eye][i] = {this, (Stereo::Eye)eye, first, end - first};
+            }
         }
 
-        double actual_damage = water.damage * modifier;
-        *damage = actual_damage;
-        this->health -= *damage;
-        return this->health <= 0;
+        this->startup.add("sensors", initSensorsTask, &arguments);
+        Startup::TaskId conversion = this->startup.add("conversion", initConversionTask, &arguments);
+        Startup::TaskId camera = this->startup.add("camera", startCameraTask, &arguments);
+        this->startup.depend(camera, conversion);
+        Startup::TaskId sprites = this->startup.add("sprites", loadSpritesTask, &arguments);
+        Startup::TaskId hud = this->startup.add("hud", buildHudTask, &arguments);
+        this->startup.depend(hud, sprites);
+        this->startup.add("text", prepareTextTask, &arguments);
+        this->startup.add("session", startSessionTask, &arguments);
+        this->startup.run(this->jobs);
+
+        this->panorama = Memory::create<Panorama>(Memory::TAG_PANORAMA);
+        this->panoramaTexture = Platform::createTexture(Panorama::SIZE, Panorama::SIZE);
+        this->panorama->upload((u16*)Platform::textureData(this->panoramaTexture));
+        Platform::flushTexture(this->panoramaTexture);
+
+        this->decalTexture = Platform::createTexture(DecalLayer::SIZE, DecalLayer::SIZE, Platform::TEXTURE_RGBA8);
+        this->decals = Memory::create<DecalLayer>(Memory::TAG_GAME, (u32*)Platform::textureData(this->decalTexture));
+        Platform::flushTexture(this->decalTexture);
+
+        this->running = true;
+        this->steps = 0;
+        this->lastTick = 0;
+        this->accumulatedTicks = 0;
+        this->pendingKeysDown = 0;
+        this->orientation.substep = 1.0f/SENSOR_RATE;
+
+        this->selectedWater = 0;
+        this->tX = this->tY = this->tZ = 0.0f;
+        this->viewX = this->viewY = 0.0f;
+        this->aimX = this->aimY = this->previousAimX = this->previousAimY = 0.0f;
     }
 
-    bool PaintSplash::isBoss()
+    void Game::initSystemTask(void*)
     {
-        return this->boss;
+        Platform::init();
     }
 
-    void PaintSplash::getAngles(double* tX, double* tY,double* tZ)
+    void Game::initSensorsTask(void*)
     {
-        *tX = this->tX;
-        *tY = this->tY;
-        *tZ = this->tZ;
+        Platform::initSensors();
     }
 
-    u32 PaintSplash::getColor()
+    void Game::initConversionTask(void*)
     {
-        return this->color;
+        Platform::initYuvConversion();
     }
 
-    Game::Game(int argc, char* argv[])
+    // The cameras themselves are brought up on the camera thread, and keep coming up while the rest of startup goes on
+    void Game::startCameraTask(void* data)
     {
-        APT_GetAppCpuTimeLimit(&this->old_time_limit);
-        APT_SetAppCpuTimeLimit(30);
+        Game* game = ((StartupArguments*)data)->game;
+        game->hardwareConversion = Platform::hasYuvConversion();
+        startCameraThread(game->cameraMode());
+    }
 
-        romfsInit();
-        DEBUG("%.8lx\n", HIDUSER_EnableAccelerometer());
-        DEBUG("%.8lx\n", HIDUSER_EnableGyroscope());
+    void Game::loadSpritesTask(void*)
+    {
+        Platform::loadSprites();
+    }
 
-        gfxInitDefault();
-        C3D_Init(C3D_DEFAULT_CMDBUF_SIZE);
-        C2D_Init(C2D_DEFAULT_MAX_OBJECTS);
-        C2D_Prepare();
+    // Drawing lists look their images up in the sprite sheet
+    void Game::buildHudTask(void* data)
+    {
+        Game* game = ((StartupArguments*)data)->game;
+        game->buildHud();
+        game->splashList = Platform::createDrawList(NULL, 0);
+        game->splashQuads = NULL;
+        game->splashQuadCount = 0;
+    }
 
-        this->top = C2D_CreateScreenTarget(GFX_TOP, GFX_LEFT);
-        this->bottom = C2D_CreateScreenTarget(GFX_BOTTOM, GFX_LEFT);
+    void Game::prepareTextTask(void* data)
+    {
+        Game* game = ((StartupArguments*)data)->game;
+        game->text.push_back(Platform::createText("Press \uE000 to fire a water beam!"));
+        game->text.push_back(Platform::createText("Press \uE002 to lock onto the boss!"));
+        game->text.push_back(Platform::createText("Press \uE003 to steal a paint splat's color!"));
+        game->text.push_back(Platform::createText("Press \uE004 or \uE005 to change water type!"));
+        game->text.push_back(Platform::createText("The closer in color, the more damage you do!"));
+        game->text.push_back(Platform::createText("Press START to exit, SELECT to toggle 3D."));
+        game->textCache.init(TEXT_SLOT_AMOUNT, 64);
+    }
 
-        spritesheet = C2D_SpriteSheetLoad("romfs:/gfx/sprites.t3x");
-        C2D_SpriteFromSheet(&paintSprite, spritesheet, sprites_paint_idx);
-        C2D_SpriteSetDepth(&paintSprite, 0.55f);
+    // The wave script, the replay or recording, and the state the first step starts from
+    void Game::startSessionTask(void* data)
+    {
+        StartupArguments* arguments = (StartupArguments*)data;
+        Game* game = arguments->game;
+        int argc = arguments->argc;
+        char** argv = arguments->argv;
+
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", Platform::DATA_DIRECTORY, WAVES_NAME);
+        game->loadWaves(argc > 2 ? argv[2] : path);
+
+        // Everything random has to come from the seed for a replay to match
+        snprintf(path, sizeof(path), "%s/%s", Platform::DATA_DIRECTORY, REPLAY_NAME);
+        u32 seed;
+        if(game->replay.open(argc > 1 ? argv[1] : path))
+        {
+            seed = game->replay.header().seed;
+            if(game->replay.header().waves != game->wavesChecksum)
+                DEBUG("replay was recorded with another wave script\n");
+        }
+        else
+        {
+            seed = (u32)Platform::ticks();
+            mkdir(Platform::DATA_DIRECTORY, 0777);
+            snprintf(path, sizeof(path), "%s/%s", Platform::DATA_DIRECTORY, RECORDING_NAME);
+            game->recorder.open(path, seed, Platform::TICKS_PER_SECOND, game->wavesChecksum);
+        }
+        game->spawnRandom.seed(seed, Random::STREAM_SPAWN);
+
+        game->waterLevel = WATER_LEVEL_MAX;
+        game->firing = false;
+        game->beamType = BEAM_NONE;
+        game->overloaded = false;
+
+        game->events.schedule(SECONDS_TO_SPAWN*SCHEDULE_RATE, EVENT_SPAWN, 0);
+        for(u32 i = 0; i < game->waveSpawns.size(); i++)
+            game->events.schedule(llroundf(game->waveSpawns[i].seconds*SCHEDULE_RATE), EVENT_WAVE, i);
+        game->hitCounter = game->lastBossSpawn = 0;
+        game->lastDamage = -1;
+        for(u32 water = 0; water < WATER_TYPE_AMOUNT; water++)
+            game->damageTable.setWater(water, game->waters[water].color, game->waters[water].damage, game->waters[water].color == clearWaterColor);
+
+        game->addPaintSplash(PaintSplash::spawn(game->paintSplashes, game->spawnRandom, 0, 0, 0));
+        game->addPaintSplash(PaintSplash::spawn(game->paintSplashes, game->spawnRandom, 45, 45, 0));
+        game->addPaintSplash(PaintSplash::spawn(game->paintSplashes, game->spawnRandom, -45, -45, 0));
+        game->addPaintSplash(PaintSplash::spawn(game->paintSplashes, game->spawnRandom, -45, 45, 0));
+        game->addPaintSplash(PaintSplash::spawn(game->paintSplashes, game->spawnRandom, 45, -45, 0));
+    }
 
-        for(int i = 0; i < BEAM_TYPE_AMOUNT; i++)
+    // A missing script is no script, one that can't be read is reported and left out
+    void Game::loadWaves(const char* path)
+    {
+        this->wavesChecksum = 0;
+        if(!Waves::load(path, this->waveSpawns, &this->wavesChecksum))
         {
-            C2D_SpriteFromSheet(&beamSprites[i], spritesheet, sprites_beam_water_idx+i);
-            C2D_SpriteSetDepth(&beamSprites[i], 0.7f);
-            C2D_SpriteSetPos(&beamSprites[i], 190.0f, 120.0f);
+            if(this->wavesChecksum != 0)
+                DEBUG("couldn't read the wave script %s\n", path);
+            this->waveSpawns.clear();
+            this->wavesChecksum = 0;
         }
+    }
 
-        this->staticBuf = C2D_TextBufNew(512);
-        this->dynamicBuf = C2D_TextBufNew(512);
+    void Game::addPaintSplash(SplashHandle paintSplash)
+    {
+        float tX, tY, tZ;
+        PaintSplash(this->paintSplashes, paintSplash).getAngles(&tX, &tY, &tZ);
+        this->splashGrid.insert(paintSplash, tX, tY);
+    }
 
-        this->addText(this->staticBuf, "Press \uE000 to fire a water beam!");
-        this->addText(this->staticBuf, "Press \uE002 to lock onto the boss!");
-        this->addText(this->staticBuf, "Press \uE003 to steal a paint splat's color!");
-        this->addText(this->staticBuf, "Press \uE004 or \uE005 to change water type!");
-        this->addText(this->staticBuf, "The closer in color, the more damage you do!");
-        this->addText(this->staticBuf, "Press START to exit.");
+    void Game::removePaintSplash(SplashHandle paintSplash)
+    {
+        float tX, tY, tZ;
+        PaintSplash(this->paintSplashes, paintSplash).getAngles(&tX, &tY, &tZ);
+        this->splashGrid.remove(paintSplash, tX, tY);
+        this->paintSplashes.remove(paintSplash);
+    }
 
-        startCameraThread();
+    Game::~Game()
+    {
+        Memory::destroy(Memory::TAG_GAME, this->jobs);
+        closeCameraThread();
+        Platform::deleteTexture(this->panoramaTexture);
+        Memory::destroy(Memory::TAG_PANORAMA, this->panorama);
+        Memory::destroy(Memory::TAG_GAME, this->decals);
+        Platform::deleteTexture(this->decalTexture);
 
-        this->waterLevel = WATER_LEVEL_MAX;
-        this->firing = false;
-        this->beamType = BEAM_NONE;
-        this->overloaded = false;
+        for(auto text : this->text)
+            Platform::deleteText(text);
+        this->textCache.exit();
+        Platform::deleteDrawList(this->hud);
+        Platform::deleteDrawList(this->splashList);
 
-        this->lastTime = osGetTime();
-        this->paintSplashes.push_back(new PaintSplash(0, 0, 0));
-        this->paintSplashes.push_back(new PaintSplash(45, 45, 0));
-        this->paintSplashes.push_back(new PaintSplash(-45, -45, 0));
-        this->paintSplashes.push_back(new PaintSplash(-45, 45, 0));
-        this->paintSplashes.push_back(new PaintSplash(45, -45, 0));
+        Platform::exit();
+    }
 
-        this->running = true;
-        this->frameCounter = 0;
+    // The cameras' own pictures already differ between the eyes, so they stay on the screen
+    // Smaller pictures see as wide but taller, so they're scaled to the screen's width and centered, their top and bottom cut off
+    void Game::drawCameraImage(Stereo::Eye eye)
+    {
+        PROFILE_ZONE(Profiler::ZONE_CAMERA_IMAGE);
+        if(!this->cameraShown)
+        {
+            Platform::drawText("Starting the camera...", 150.0f, 112.0f, 0.5f, textScale, textColor);
+            return;
+        }
 
-        this->selectedWater = 0;
-        this->tX = this->tY = this->tZ = 0.0f;
+        float scale = (float)CAMERA_BUFFER_WIDTH/arg->mode.width;
+        float y = (CAMERA_BUFFER_HEIGHT - arg->mode.height*scale)/2;
+        Platform::drawTexture(arg->textures[eye], 0.0f, y, 0.5f, scale, scale);
     }
 
-    void Game::addText(C2D_TextBuf textBuf, const char* text)
+    // The layer around the view, with as many degrees per pixel as splashes near the center, at their depth in 3D
+    void Game::drawDecals(Stereo::Eye eye, float slider)
     {
-        C2D_Text* c2dtext = new C2D_Text;
-        C2D_TextParse(c2dtext, textBuf, text);
-        C2D_TextOptimize(c2dtext);
-        this->text.push_back(c2dtext);
+        float u = DecalLayer::column(this->viewY - DECAL_HALF_VIEW), v = DecalLayer::row(this->viewX - DECAL_HALF_VIEW);
+        float span = 2*DECAL_HALF_VIEW/DecalLayer::PIXEL_ANGLE;
+        Platform::drawTextureWrapped(this->decalTexture, u, v, span, span, Stereo::eyeOffset(eye, slider, splashPopOut), 0.0f, 0.52f,
+            CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT);
     }
 
-    Game::~Game()
+    void Game::drawPaintSplashes(Stereo::Eye eye, float slider)
     {
-        closeCameraThread();
+        PROFILE_ZONE(Profiler::ZONE_PAINT_SPLASHES);
+        Platform::drawDrawList(this->splashList, Stereo::eyeOffset(eye, slider, splashPopOut));
+    }
 
-        for(auto paintSplash : this->paintSplashes)
-            delete paintSplash;
+    void Game::convertCameraJob(void* data)
+    {
+        CameraBand* band = (CameraBand*)data;
+        convertCameraRows(band->eye, band->firstTileRow, band->tileRows);
+    }
 
-        for(auto text : this->text)
-            delete text;
+    // Given any band of the eye to flush
+    void Game::flushCameraJob(void* data)
+    {
+        flushCameraTexture(((CameraBand*)data)->eye);
+    }
+
+    // Given the eye's first band, the whole eye is converted at once
+    void Game::convertCameraTextureJob(void* data)
+    {
+        CameraBand* band = (CameraBand*)data;
+        if(convertCameraTexture(band->eye))
+            return;
+
+        band->game->conversionFailed = true;
+        convertCameraRows(band->eye, 0, CAMERA_TILE_ROWS);
+        flushCameraTexture(band->eye);
+    }
 
-        C2D_TextBufDelete(this->dynamicBuf);
-        C2D_TextBufDelete(this->staticBuf);
+    void Game::cullSplashesJob(void* data)
+    {
+        Game* game = (Game*)data;
+        auto& visible = game->visibleSplashes;
+        game->splashGrid.query(game->viewX, game->viewY, angleVisible, visible);
+        game->splashQuadCount = 0;
+        game->splashQuads = game->frameArena.allocate<Platform::Quad>(visible.size());
+        if(game->splashQuads == NULL)
+            return;
+        for(auto handle : visible)
+        {
+            PaintSplash paintSplash(game->paintSplashes, handle);
+            if(paintSplash.isVisible(game->viewX, game->viewY))
+                game->splashQuads[game->splashQuadCount++] = paintSplash.quad(game->viewX, game->viewY);
+        }
+    }
+
+    // The frame is stitched in at the view it's drawn at, the GPU being done with the texture like with the camera's
+    void Game::stitchPanoramaJob(void* data)
+    {
+        Game* game = (Game*)data;
+        game->panorama->stitch(arg->frames->readBuffer(), arg->mode.width, arg->mode.height, (Platform::CameraFormat)arg->mode.format,
+            game->viewX, game->viewY, PANORAMA_BUDGET_TICKS);
+        if(game->panorama->upload((u16*)Platform::textureData(game->panoramaTexture)) > 0)
+            Platform::flushTexture(game->panoramaTexture);
+    }
 
-        C2D_Fini();
-        C3D_Fini();
-        gfxExit();
+    void Game::blendDecalsJob(void* data)
+    {
+        Game* game = (Game*)data;
+        if(game->decals->blend() > 0)
+            Platform::flushTexture(game->decalTexture);
+    }
 
-        DEBUG("%.8lx\n", HIDUSER_DisableGyroscope());
-        DEBUG("%.8lx\n", HIDUSER_DisableAccelerometer());
-        romfsExit();
+    // Work that only reads the simulation, spread over the other cores while this one helps
+    // The GPU is done with the camera textures once the frame has begun, so they can be written again
+    void Game::runFrameJobs(u32 eyes)
+    {
+        PROFILE_ZONE(Profiler::ZONE_FRAME_JOBS);
 
-        if(this->old_time_limit != UINT32_MAX)
+        // A frame left unconverted is simply replaced by the next one in the triple buffer
+        if(this->drawnFrames % this->governor.settings().convertInterval == 0 && acquireCameraFrame())
         {
-            APT_SetAppCpuTimeLimit(this->old_time_limit);
+            this->cameraShown = true;
+            this->jobs->add(stitchPanoramaJob, this);
+
+            // The Y2R unit takes one eye at a time, and the thread waiting on it leaves the rest to the others
+            if(arg->mode.format == Platform::CAMERA_YUV422 && this->hardwareConversion)
+            {
+                JobSystem::JobId previous = 0;
+                for(u32 eye = 0; eye < eyes; eye++)
+                {
+                    JobSystem::JobId convert = this->jobs->add(convertCameraTextureJob, &this->cameraBands[eye][0]);
+                    if(eye > 0)
+                        this->jobs->depend(convert, previous);
+                    previous = convert;
+                }
+            }
+            else
+            {
+                for(u32 eye = 0; eye < eyes; eye++)
+                {
+                    JobSystem::JobId flush = this->jobs->add(flushCameraJob, &this->cameraBands[eye][0]);
+                    for(u32 i = 0; i < CAMERA_JOBS; i++)
+                        this->jobs->depend(flush, this->jobs->add(convertCameraJob, &this->cameraBands[eye][i]));
+                }
+            }
         }
+        this->jobs->add(cullSplashesJob, this);
+        if(this->decals->pending() > 0)
+            this->jobs->add(blendDecalsJob, this);
+
+        this->jobs->run();
+    }
+
+    // Only 3D captures both outer cameras
+    void Game::setStereo(bool stereo)
+    {
+        this->stereo = stereo;
+        Platform::setStereo(stereo);
+        this->updateCamera();
     }
 
-    void Game::drawCameraImage()
+    // The CPU path stays on RGB565, which it only has to swizzle, converting YUV422 on it being slower
+    void Game::setHardwareConversion(bool enabled)
     {
-        svcWaitSynchronization(arg->mutex, UINT64_MAX);
-        convertCameraBuffer();
-        C2D_DrawImageAt(arg->image, 0.0f, 0.0f, 0.5f, NULL, 1.0f, 1.0f);
-        svcReleaseMutex(arg->mutex);
+        this->hardwareConversion = enabled && Platform::hasYuvConversion();
+        this->updateCamera();
     }
 
-    void Game::drawPaintSplashes()
+    Platform::CameraMode Game::cameraMode()
     {
-        for(auto const& paintSplash : this->paintSplashes)
-            if(paintSplash->isVisible(this->tX, this->tY, this->tZ))
-                paintSplash->draw(this->tX, this->tY, this->tZ);
+        const CaptureGovernor::Level& level = this->governor.settings();
+        Platform::CameraFormat format = this->hardwareConversion ? Platform::CAMERA_YUV422 : Platform::CAMERA_RGB565;
+        return {level.width, level.height, level.frameRate, (u8)(this->stereo ? 2 : 1), (u8)format};
     }
 
-    void Game::drawHitCounter()
+    // The camera has to start over to capture differently, but not for a different conversion rate
+    void Game::updateCamera()
     {
-        float start_x = 400 - 128 - 8;
+        Platform::CameraMode mode = this->cameraMode();
+        if(mode.width == arg->mode.width && mode.height == arg->mode.height && mode.frameRate == arg->mode.frameRate && mode.cameras == arg->mode.cameras
+            && mode.format == arg->mode.format)
+            return;
+
+        closeCameraThread();
+        startCameraThread(mode);
+    }
+
+    // Everything the HUD could show, the parts that change are patched by updateHud
+    void Game::buildHud()
+    {
+        this->hudQuads.resize(HUD_QUAD_AMOUNT);
+        Platform::Quad* quads = this->hudQuads.data();
+        auto image = [](u32 image, float x, float y, float depth) { return Platform::Quad{image, x, y, depth, 0, 0, 1.0f, 0, false}; };
+        auto rect = [](float x, float y, float depth, float width, float height, u32 color) { return Platform::Quad{Platform::NO_IMAGE, x, y, depth, width, height, 1.0f, color, false}; };
+
+        quads[HUD_SELECTED_COLOR] = rect(182.0f, 169.0f, 0.55f, 36.0f, 18.0f, 0);
+        quads[HUD_GUN] = image(sprites_gun_idx, 0.0f, 0.0f, 0.6f);
+        quads[HUD_WATER_LEVEL] = rect(15.0f, 205.0f, 0.7f, 0, 20, 0);
+        quads[HUD_WATER_OVERLAY] = image(sprites_water_overlay_idx, 13.0f, 203.0f, 0.8f);
+
+        float start_x = 200 - ((WATER_TYPE_AMOUNT*32)/2.0f);
         float y = 199.0f;
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_counter_overlay_idx), start_x, y, 0.7f, NULL, 1.0f, 1.0f);
-        constexpr size_t DIGITS_AMOUNT = 8;
-        start_x += 128 - 21;
-        for(size_t i = 0, big = 1; i != DIGITS_AMOUNT; i++, big *= 10)
+        for(size_t i = 0; i < WATER_TYPE_AMOUNT; i++)
         {
-            int cnt = (this->hitCounter % (big*10))/big;
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_0_idx+cnt), start_x - ((12+2)*i), y+5, 0.8f, NULL, 1.0f, 1.0f);
+            quads[HUD_WATER_TYPES + 2*i] = rect(start_x + 4 + 32*i, y+4, 0.7f, 24, 24, this->waters[i].color);
+            quads[HUD_WATER_TYPES + 2*i + 1] = image(sprites_water_type_idx, start_x + 32*i, y, 0.8f);
         }
+
+        start_x = 400 - 128 - 8;
+        quads[HUD_COUNTER_OVERLAY] = image(sprites_counter_overlay_idx, start_x, y, 0.7f);
+        start_x += 128 - 21;
+        for(size_t i = 0; i != HIT_COUNTER_DIGITS; i++)
+            quads[HUD_DIGITS + i] = image(sprites_0_idx, start_x - ((12+2)*i), y+5, 0.8f);
+
+        this->hud = Platform::createDrawList(quads, HUD_QUAD_AMOUNT);
     }
 
-    void Game::drawOverlay()
+    // setQuad ignores quads that didn't change, so only those are prepared and sorted again
+    void Game::updateHud()
     {
-        C2D_DrawRectSolid(182.0f, 169.0f, 0.55f, 36.0f, 18.0f, waterProperties[this->selectedWater].color);
-        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_gun_idx), 0.0f, 0.0f, 0.6f, NULL, 1.0f, 1.0f);
+        Platform::Quad* quads = this->hudQuads.data();
+        u32 color = this->waters[this->selectedWater].color;
 
-        C2D_DrawRectSolid(15.0f, 205.0f, 0.7f, this->waterLevel, 20, waterProperties[this->selectedWater].color);
-        if(this->overloaded)
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_water_overloaded_idx), 13.0f, 203.0f, 0.8f, NULL, 1.0f, 1.0f);
-        else
-            C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_water_overlay_idx), 13.0f, 203.0f, 0.8f, NULL, 1.0f, 1.0f);
+        quads[HUD_SELECTED_COLOR].color = color;
+        quads[HUD_WATER_LEVEL].color = color;
+        quads[HUD_WATER_LEVEL].width = this->waterLevel;
+        quads[HUD_WATER_OVERLAY].image = this->overloaded ? sprites_water_overloaded_idx : sprites_water_overlay_idx;
 
-        float start_x = 200 - ((waterProperties.size()*32)/2.0f);
-        float y = 199.0f;
-        for(size_t i = 0; i < waterProperties.size(); i++)
+        for(size_t i = 0; i < WATER_TYPE_AMOUNT; i++)
+            quads[HUD_WATER_TYPES + 2*i + 1].image = i == (size_t)this->selectedWater ? sprites_water_selected_idx : sprites_water_type_idx;
+
+        for(size_t i = 0, big = 1; i != HIT_COUNTER_DIGITS; i++, big *= 10)
         {
-            C2D_DrawRectSolid(start_x + 4 + 32*i, y+4, 0.7f, 24, 24, waterProperties[i].color);
-            if(i == (size_t)this->selectedWater)
-                C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_water_selected_idx), start_x + 32*i, y, 0.8f, NULL, 1.0f, 1.0f);
-            else
-                C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, sprites_water_type_idx), start_x + 32*i, y, 0.8f, NULL, 1.0f, 1.0f);
+            int cnt = (this->hitCounter % (big*10))/big;
+            quads[HUD_DIGITS + i].image = sprites_0_idx+cnt;
         }
 
-        this->drawHitCounter();
+        for(u32 i = 0; i < HUD_QUAD_AMOUNT; i++)
+            Platform::setQuad(this->hud, i, quads[i]);
+    }
+
+    void Game::drawOverlay(Stereo::Eye eye, float slider)
+    {
+        PROFILE_ZONE(Profiler::ZONE_OVERLAY);
+
+        float offsetX = Stereo::eyeOffset(eye, slider, hudPopOut);
+        Platform::DrawStats stats = Platform::drawDrawList(this->hud, offsetX);
+        PROFILE_COUNTER(Profiler::COUNTER_HUD_VERTICES, stats.vertices);
+        PROFILE_COUNTER(Profiler::COUNTER_HUD_DRAW_CALLS, stats.drawCalls);
 
         if(this->firing)
         {
             if(this->beamType != BEAM_NONE)
             {
-                C2D_ImageTint tint;
-                C2D_PlainImageTint(&tint, waterProperties[this->selectedWater].color, 1.0f);
-                C2D_DrawSpriteTinted(&beamSprites[this->beamType], &tint);
+                Platform::drawImageTinted(sprites_beam_water_idx+this->beamType, 190.0f + offsetX, 120.0f, 0.7f, this->waters[this->selectedWater].color);
             }
             if(this->lastDamage != -1)
             {
-                char buffer[128] = {0};
-                DEBUG("damage: %i\n", this->lastDamage);
-                sprintf(buffer, "%i", this->lastDamage);
-
-                this->addText(dynamicBuf, buffer);
-                C2D_DrawText(this->text.back(), C2D_WithColor, 220.0f, 110.0f, 0.65f, textScale, textScale, textColor);
-                delete this->text.back();
-                this->text.pop_back();
-
-                this->lastDamage = -1;
+                this->textCache.drawNumber(this->lastDamage, 220.0f + offsetX, 110.0f, 0.65f, textScale, textColor);
             }
         }
     }
 
     void Game::drawText()
     {
-        constexpr size_t INFO_LINES = 3;
-        char buffer[INFO_LINES][128] = {0};
-        sprintf(buffer[0], "Roll: %d\nYaw: %d\nPitch: %d\n", this->rate.x, this->rate.y, this->rate.z);
-        sprintf(buffer[1], "x: %d\ny: %d\nz: %d\n", this->vector.x, this->vector.y, this->vector.z);
-        sprintf(buffer[2], "tX: %f\ntY: %f\ntZ: %f\n", this->tX, this->tY, this->tZ);   
+        PROFILE_ZONE(Profiler::ZONE_TEXT);
 
         size_t i = 0;
         for(i = 0; i < this->text.size(); i++)
         {
-            C2D_DrawText(this->text[i], C2D_WithColor, 5, 5+i*15, 0.5f, textScale, textScale, textColor);
+            Platform::drawText(this->text[i], 5, 5+i*15, 0.5f, textScale, textColor);
         }
 
         float y = 5+i*15;
-        for(i = 0; i != INFO_LINES; i++)
-        {
-            this->addText(dynamicBuf, buffer[i]);
-            C2D_DrawText(this->text.back(), C2D_WithColor, 5+80*i, y, 0.5f, textScale, textScale, textColor);
-            delete this->text.back();
-            this->text.pop_back();
-        }
+        char buffer[64] = {0};
+
+#ifdef PROFILER
+        // The timings take the place of the raw sensor dump
+        sprintf(buffer, "Paint splats left: %u", (unsigned int)this->paintSplashes.size());
+        this->textCache.draw(TEXT_SPLASH_COUNT, buffer, 5, y, 0.5f, textScale, textColor);
+        Profiler::drawOverlay(5, y + 15, 0.5f, textColor);
+#else
+        // Angles are rounded so the text isn't parsed again for changes too small to read
+        sprintf(buffer, "Roll: %d\nYaw: %d\nPitch: %d\n", this->lastFrame.gyro[0], this->lastFrame.gyro[2], this->lastFrame.gyro[1]);
+        this->textCache.draw(TEXT_GYROSCOPE, buffer, 5, y, 0.5f, textScale, textColor);
+        sprintf(buffer, "x: %d\ny: %d\nz: %d\n", this->lastFrame.accel[0], this->lastFrame.accel[1], this->lastFrame.accel[2]);
+        this->textCache.draw(TEXT_ACCELEROMETER, buffer, 5+80, y, 0.5f, textScale, textColor);
+        sprintf(buffer, "tX: %.1f\ntY: %.1f\ntZ: %.1f\n", this->tX, this->tY, this->tZ);
+        this->textCache.draw(TEXT_ANGLES, buffer, 5+80*2, y, 0.5f, textScale, textColor);
 
         y += 15*3;
-        sprintf(buffer[0], "Paint splats left: %u", this->paintSplashes.size());
-        this->addText(dynamicBuf, buffer[0]);
-        C2D_DrawText(this->text.back(), C2D_WithColor, 5, y, 0.5f, textScale, textScale, textColor);
-        delete this->text.back();
-        this->text.pop_back();
-        #undef INFO_LINES
+        sprintf(buffer, "Paint splats left: %u", (unsigned int)this->paintSplashes.size());
+        this->textCache.draw(TEXT_SPLASH_COUNT, buffer, 5, y, 0.5f, textScale, textColor);
+#endif
     }
 
     void Game::draw()
     {
-        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+        PROFILE_ZONE(Profiler::ZONE_DRAW);
+        this->frameArena.reset();
+
+        {
+            PROFILE_ZONE(Profiler::ZONE_FRAME_BEGIN);
+            u64 start = Platform::ticks();
+            Platform::beginFrame();
+            this->frameWaitTicks = Platform::ticks() - start;
+        }
 
-        C2D_TextBufClear(dynamicBuf);
+        // The right eye is only converted and drawn while it can be seen
+        float slider = this->stereo ? Platform::stereoSlider() : 0.0f;
+        u32 eyes = slider > 0.0f ? Stereo::EYE_AMOUNT : 1;
+        this->runFrameJobs(eyes);
+
+        // Both eyes draw the same lists, only moved apart
+        Platform::setQuads(this->splashList, this->splashQuads, this->splashQuadCount);
+        this->updateHud();
+
+        for(u32 eye = 0; eye < eyes; eye++)
+        {
+            Platform::beginScreen(eye == Stereo::EYE_LEFT ? Platform::SCREEN_TOP : Platform::SCREEN_TOP_RIGHT, backgroundColor);
 
-        C2D_SceneBegin(top);
-        C2D_TargetClear(top, backgroundColor);
+            this->drawCameraImage((Stereo::Eye)eye);
+            this->drawDecals((Stereo::Eye)eye, slider);
+            this->drawPaintSplashes((Stereo::Eye)eye, slider);
+            this->drawOverlay((Stereo::Eye)eye, slider);
+        }
 
-        this->drawCameraImage();
-        this->drawPaintSplashes();
-        this->drawOverlay();
+        if(this->firing && this->lastDamage != -1)
+        {
+            DEBUG("damage: %i\n", this->lastDamage);
+            this->lastDamage = -1;
+        }
+        this->drawnFrames++;
 
-        C2D_SceneBegin(bottom);
-        C2D_TargetClear(bottom, backgroundColor);
+        Platform::beginScreen(Platform::SCREEN_BOTTOM, backgroundColor);
 
         this->drawText();
+        this->drawMinimap();
+
+        Platform::endFrame();
+
+        // Startup is over once the camera's picture is on the screen
+        this->startup.reach(Startup::MILESTONE_FIRST_FRAME);
+        if(this->cameraShown && !this->startup.reached(Startup::MILESTONE_CAMERA))
+        {
+            this->startup.reach(Startup::MILESTONE_CAMERA);
+            this->startup.report();
+        }
+    }
+
+    // The panorama in the bottom screen's corner, with a dot where the top screen looks
+    void Game::drawMinimap()
+    {
+        float scale = MINIMAP_SIZE/Panorama::SIZE;
+        float x = 320 - MINIMAP_SIZE - 4, y = 240 - MINIMAP_SIZE - 4;
+        Platform::drawTexture(this->panoramaTexture, x, y, 0.5f, scale, scale);
+        Platform::drawRect(x + Panorama::column(this->viewY)*scale - 2, y + Panorama::row(this->viewX)*scale - 2, 0.6f, 4, 4, textColor);
+    }
+
+    int Game::getHitCounter()
+    {
+        return this->hitCounter;
+    }
 
-        C3D_FrameEnd(0);
+    size_t Game::getSplashCount()
+    {
+        return this->paintSplashes.size();
+    }
+
+    const Startup& Game::getStartup()
+    {
+        return this->startup;
+    }
+
+    // FNV-1a over the score and every splash, in pool order
+    u32 Game::checksum()
+    {
+        u32 hash = 2166136261u;
+        auto mix = [&hash](const void* data, size_t size) {
+            for(size_t i = 0; i < size; i++)
+                hash = (hash ^ ((const u8*)data)[i]) * 16777619u;
+        };
+
+        mix(&this->hitCounter, sizeof(this->hitCounter));
+        size_t count = this->paintSplashes.size();
+        mix(this->paintSplashes.anglesX(), count*sizeof(float));
+        mix(this->paintSplashes.anglesY(), count*sizeof(float));
+        mix(this->paintSplashes.anglesZ(), count*sizeof(float));
+        mix(this->paintSplashes.healths(), count*sizeof(float));
+        mix(this->paintSplashes.colors(), count*sizeof(u32));
+        mix(this->paintSplashes.flagBits(), count*sizeof(u8));
+        mix(this->waters.data(), sizeof(this->waters));
+        return hash;
     }
 
-    void Game::lockOn(PaintSplash* paintSplash)
+    void Game::lockOn(SplashHandle paintSplash)
     {
-        paintSplash->getAngles(&this->tX, &this->tY, &this->tZ);
+        float splashX, splashY, splashZ;
+        PaintSplash(this->paintSplashes, paintSplash).getAngles(&splashX, &splashY, &splashZ);
+        this->aimX += splashX - this->tX;
+        this->aimY += splashY - this->tY;
+        // Snaps the view there instead of sliding it over the step
+        this->previousAimX += splashX - this->tX;
+        this->previousAimY += splashY - this->tY;
+        this->updateCameraAngles();
+    }
+
+    // The camera looks where the console points, shifted by however much the player aimed by hand
+    void Game::updateCameraAngles()
+    {
+        this->aimX = FastMath::wrapDegrees(this->aimX);
+        this->aimY = FastMath::wrapDegrees(this->aimY);
+        this->tX = FastMath::wrapDegrees(this->orientation.pitch() + this->aimX);
+        this->tY = FastMath::wrapDegrees(-this->orientation.roll() + this->aimY);
+        this->tZ = FastMath::wrapDegrees(-this->orientation.yaw());
+    }
+
+    // Live input is recorded, unless a replay is running, in which case it's used instead
+    bool Game::nextFrame(Recording::Frame* frame)
+    {
+        Platform::Input input;
+        Platform::readInput(&input);
+        if(this->replay.isOpen())
+            return !(input.keysDown & KEY_START) && this->replay.next(frame);
+
+        frame->tick = Platform::ticks();
+        frame->seed = 0;
+        frame->keysDown = input.keysDown;
+        frame->keysHeld = input.keysHeld;
+        for(int i = 0; i < 3; i++)
+        {
+            frame->accel[i] = input.accel[i];
+            frame->gyro[i] = input.gyro[i];
+        }
+
+        float angleX, angleY;
+        switch(takeCameraMotion(&angleX, &angleY))
+        {
+            case MOTION_FOUND:
+                frame->motion[0] = std::clamp(angleX*100, -30000.0f, 30000.0f);
+                frame->motion[1] = std::clamp(angleY*100, -30000.0f, 30000.0f);
+                break;
+            case MOTION_LOST:
+                frame->motion[0] = frame->motion[1] = Recording::LOST_MOTION;
+                break;
+            default:
+                frame->motion[0] = frame->motion[1] = Recording::NO_MOTION;
+                break;
+        }
+        getCameraPalette(frame->palette);
+        frame->reserved = 0;
+        this->recorder.write(*frame);
+        return true;
     }
 
     void Game::update()
-    {   
-        hidScanInput();
+    {
+        PROFILE_ZONE(Profiler::ZONE_UPDATE);
+        u64 start = Platform::ticks();
+
+        Recording::Frame frame;
+        if(!this->nextFrame(&frame))
+        {
+            this->running = false;
+            return;
+        }
+
+        this->simulate(frame);
+        if(this->running)
+        {
+            // 3D doesn't change the game, so it's switched outside of simulate
+            if(frame.keysDown & KEY_SELECT)
+                this->setStereo(!this->stereo);
+            // Switches back to converting the camera on the CPU, and again to the Y2R unit, the profiler's timings comparing both
+            if(frame.keysDown & KEY_ZL)
+            {
+                this->setHardwareConversion(!this->hardwareConversion);
+                DEBUG("camera converted on the %s\n", this->hardwareConversion ? "y2r unit" : "cpu");
+            }
+            this->draw();
 
-        hidAccelRead(&this->vector);
-        hidGyroRead(&this->rate);
-        ComplementaryFilter(this->vector, this->rate, &this->tX, &this->tY, &this->tZ);
+            if(this->conversionFailed)
+            {
+                DEBUG("y2r conversion failed, falling back to the CPU\n");
+                this->conversionFailed = false;
+                this->setHardwareConversion(false);
+            }
 
-        u32 kDown = hidKeysDown();
-        u32 kHeld = hidKeysHeld();
+            // Waiting for the previous frame to be shown isn't work the camera could spare
+            if(this->governor.update(Platform::ticks() - start - this->frameWaitTicks))
+            {
+                DEBUG("capture level %lu\n", (unsigned long)this->governor.level());
+                this->updateCamera();
+            }
+        }
+    }
 
-        if(kDown & KEY_START)
+    // Only reads the frame, so the same frames always lead to the same game
+    // The sensors are taken in once per frame, the rules run in as many fixed steps as the frame's time covers
+    void Game::simulate(const Recording::Frame& frame)
+    {
+        this->lastFrame = frame;
+        this->orientation.update(makeImuSample(frame));
+        if(frame.motion[0] == Recording::LOST_MOTION)
+            this->orientation.dropVisualRotation();
+        else if(frame.motion[0] != Recording::NO_MOTION)
+            this->orientation.applyVisualRotation(frame.motion[0]/100.0f, frame.motion[1]/100.0f);
+        this->updateCameraAngles();
+
+        if(frame.keysDown & KEY_START)
         {
             this->running = false;
             return;
         }
 
-        this->draw();
+        // The first frame runs a step right away, a stall longer than MAX_STEPS is given up on instead of caught up with
+        if(this->lastTick == 0)
+        {
+            this->accumulatedTicks = STEP_TICKS;
+            this->lastTick = frame.tick;
+        }
+        else if(frame.tick > this->lastTick)
+        {
+            this->accumulatedTicks = std::min(this->accumulatedTicks + (frame.tick - this->lastTick), MAX_STEPS*STEP_TICKS);
+            this->lastTick = frame.tick;
+        }
+
+        // Presses from a frame too short for a step go to the next one
+        this->pendingKeysDown |= frame.keysDown;
+        while(this->accumulatedTicks >= STEP_TICKS)
+        {
+            this->step(frame);
+            this->accumulatedTicks -= STEP_TICKS;
+        }
+        this->updateView();
+    }
+
+    void Game::step(const Recording::Frame& frame)
+    {
+        u32 kDown = this->pendingKeysDown;
+        u32 kHeld = frame.keysHeld;
+        this->pendingKeysDown = 0;
+        this->previousAimX = this->aimX;
+        this->previousAimY = this->aimY;
 
         if(kDown & KEY_X)
         {
-            for(auto paintSplash : this->paintSplashes)
+            const u8* flags = this->paintSplashes.flagBits();
+            for(u32 i = 0; i < this->paintSplashes.size(); i++)
             {
-                if(paintSplash->isBoss())
+                if(flags[i] & SplashPool::FLAG_BOSS)
                 {
-                    this->lockOn(paintSplash);
+                    this->lockOn(this->paintSplashes.handleAt(i));
                     break;
                 }
             }
@@ -501,29 +972,27 @@ namespace Game
         {
             this->selectedWater--;
             if(this->selectedWater < 0)
-                this->selectedWater += waterProperties.size();
+                this->selectedWater += WATER_TYPE_AMOUNT;
         }
 
         if(kDown & KEY_R)
         {
             this->selectedWater++;
-            if(this->selectedWater >= (int)waterProperties.size())
+            if(this->selectedWater >= (int)WATER_TYPE_AMOUNT)
                 this->selectedWater = 0;
         }
 
         if(kHeld & KEY_CPAD_LEFT || kDown & KEY_LEFT)
-            this->tY -= 2.0f;
+            this->aimY -= 2.0f;
         else if(kHeld & KEY_CPAD_RIGHT || kDown & KEY_RIGHT)
-            this->tY += 2.0f;
+            this->aimY += 2.0f;
 
         if(kHeld & KEY_CPAD_UP || kDown & KEY_UP)
-            this->tX -= 2.0f;
+            this->aimX -= 2.0f;
         else if(kHeld & KEY_CPAD_DOWN || kDown & KEY_DOWN)
-            this->tX += 2.0f;
+            this->aimX += 2.0f;
 
-        this->tY = constrainAngle(this->tY);
-        this->tX = constrainAngle(this->tX);
-        this->tZ = constrainAngle(this->tZ);
+        this->updateCameraAngles();
 
         this->beamType = BEAM_NONE;
         this->firing = false;
@@ -542,13 +1011,13 @@ namespace Game
             }
         }
 
-        if(firing && beamType == BEAM_WATER && this->frameCounter % FRAMES_TO_SPEND == 0)
+        if(firing && beamType == BEAM_WATER && this->steps % STEPS_TO_SPEND == 0)
             this->waterLevel--;
 
         if(this->waterLevel == 0)
             this->overloaded = true;
 
-        if((this->overloaded || !(kHeld & KEY_A)) && !firing && this->waterLevel < WATER_LEVEL_MAX && frameCounter % FRAMES_TO_RELOAD == 0)
+        if((this->overloaded || !(kHeld & KEY_A)) && !firing && this->waterLevel < WATER_LEVEL_MAX && this->steps % STEPS_TO_RELOAD == 0)
             this->waterLevel++;
 
         if(this->overloaded && this->waterLevel == WATER_LEVEL_MAX)
@@ -556,51 +1025,95 @@ namespace Game
 
         if(firing)
         {
-            size_t i = 0;
-            for(; i < this->paintSplashes.size(); i++)
+            // Bosses have a center twice as big, so look that far and let the beam sort it out
+            this->splashGrid.query(this->tX, this->tY, angleCenter*2, this->queriedSplashes);
+            bool killed = false;
+            if(this->beamType == BEAM_WATER)
             {
-                if(this->paintSplashes[i]->isInCenter(this->tX, this->tY, this->tZ))
-                {
-                    if(this->beamType == BEAM_WATER && this->paintSplashes[i]->hit(waterProperties[this->selectedWater], &this->lastDamage))
-                    {
-                        DEBUG("killed!\n");
-                        this->hitCounter += this->paintSplashes[i]->isBoss() ? POINTS_FOR_BOSS : 1;
+                DamageTable::Beam beam = {this->tX, this->tY, angleCenter, (u32)this->selectedWater, BEAM_MODE};
+                int damage = this->damageTable.hit(this->paintSplashes, beam, this->queriedSplashes, this->killedSplashes);
+                if(damage != -1)
+                    this->lastDamage = damage;
 
-                        delete this->paintSplashes[i];
-                        this->paintSplashes.erase(this->paintSplashes.begin()+i);
-                        break;
-                    }
-                    else if(this->beamType == BEAM_STEAL && this->selectedWater != 0 && !this->paintSplashes[i]->isBoss())
+                // Removing moves splashes around in the pool, so only once the whole beam is resolved
+                for(auto handle : this->killedSplashes)
+                {
+                    DEBUG("killed!\n");
+                    PaintSplash paintSplash(this->paintSplashes, handle);
+                    float sX, sY, sZ;
+                    paintSplash.getAngles(&sX, &sY, &sZ);
+                    this->decals->add({sX, sY, paintSplash.isBoss() ? DECAL_RADIUS*2 : DECAL_RADIUS, paintSplash.getColor() | 0xFF000000});
+                    this->hitCounter += paintSplash.isBoss() ? POINTS_FOR_BOSS : 1;
+                    this->removePaintSplash(handle);
+                }
+                killed = !this->killedSplashes.empty();
+                this->killedSplashes.clear();
+            }
+            else if(this->selectedWater != 0)
+            {
+                for(auto handle : this->queriedSplashes)
+                {
+                    PaintSplash paintSplash(this->paintSplashes, handle);
+                    if(paintSplash.isInCenter(this->tX, this->tY) && !paintSplash.isBoss())
                     {
-                        u32 newColor = this->paintSplashes[i]->getColor();
-                        if(waterProperties[this->selectedWater].color != newColor)
+                        WaterProperty& water = this->waters[this->selectedWater];
+                        u32 newColor = paintSplash.getColor();
+                        if(water.color != newColor)
                         {
-                            waterProperties[this->selectedWater].color = newColor;
+                            water.color = newColor;
+                            this->damageTable.setWater(this->selectedWater, water.color, water.damage);
                             this->waterLevel = 0;
                             this->overloaded = true;
                         }
                     }
                 }
             }
-            if(i != this->paintSplashes.size()) // If break happened == 1 kill
+            if(killed && this->hitCounter - this->lastBossSpawn >= KILLS_TO_BOSS)
             {
-                if(this->hitCounter - this->lastBossSpawn >= KILLS_TO_BOSS)
-                {
-                    DEBUG("adding boss\n");
-                    this->paintSplashes.push_back(new PaintSplash(true));
-                    this->lastBossSpawn = this->hitCounter;
-                }
+                this->events.schedule(this->events.time(), EVENT_BOSS, 0);
+                this->lastBossSpawn = this->hitCounter;
             }
         }
 
-        this->frameCounter++;
-        this->frameCounter %= 60;
+        // Only what's due is looked at, however many scripted spawns are still waiting
+        this->events.advance(this->steps*SCHEDULE_RATE/STEP_RATE, this->dueEvents);
+        for(const auto& event : this->dueEvents)
+            this->runEvent(event, frame);
+        this->dueEvents.clear();
+
+        this->steps++;
+    }
+
+    // The aim is shown between where the last two steps left it, by how far the time since the last one went towards the next
+    // The console's own orientation is taken in every frame, so it's shown as it is
+    void Game::updateView()
+    {
+        float blend = (float)this->accumulatedTicks/STEP_TICKS;
+        float aimX = this->previousAimX + angleDelta(this->aimX, this->previousAimX)*blend;
+        float aimY = this->previousAimY + angleDelta(this->aimY, this->previousAimY)*blend;
+        this->viewX = FastMath::wrapDegrees(this->orientation.pitch() + aimX);
+        this->viewY = FastMath::wrapDegrees(-this->orientation.roll() + aimY);
+    }
 
-        if(osGetTime() >= this->lastTime + SECONDS_TO_SPAWN*1000) //every 10 seconds
+    void Game::runEvent(const TimerWheel::Event& event, const Recording::Frame& frame)
+    {
+        switch(event.type)
         {
-            this->lastTime = osGetTime();
-            this->paintSplashes.push_back(new PaintSplash(false));
-            DEBUG("adding\n");
+            case EVENT_SPAWN:
+                this->addPaintSplash(PaintSplash::spawn(this->paintSplashes, this->spawnRandom, false, this->waters, frame.palette));
+                this->events.schedule(event.time + SECONDS_TO_SPAWN*SCHEDULE_RATE, EVENT_SPAWN, 0);
+                DEBUG("adding\n");
+                break;
+            case EVENT_BOSS:
+                this->addPaintSplash(PaintSplash::spawn(this->paintSplashes, this->spawnRandom, true, this->waters));
+                DEBUG("adding boss\n");
+                break;
+            case EVENT_WAVE:
+            {
+                const Waves::Spawn& spawn = this->waveSpawns[event.argument];
+                this->addPaintSplash(PaintSplash::spawnAt(this->paintSplashes, this->spawnRandom, FastMath::wrapDegrees(spawn.tX), FastMath::wrapDegrees(spawn.tY), spawn.boss, this->waters, frame.palette));
+                break;
+            }
         }
     }
 }
@@ -1,14 +1,30 @@
 #pragma once
 
 #include "common.h"
+#include "angular_grid.h"
+#include "splash_pool.h"
+#include "orientation.h"
+#include "recording.h"
+#include "text_cache.h"
+#include "jobs.h"
+#include "stereo.h"
+#include "capture_governor.h"
+#include "random.h"
+#include "timer_wheel.h"
+#include "waves.h"
+#include "damage.h"
+#include "frame_arena.h"
+#include "startup.h"
+#include "panorama.h"
+#include "decal_layer.h"
 #include <vector>
 #include <array>
 #include <tuple>
 
 namespace Game
 {
-    constexpr u32 backgroundColor = C2D_Color32(0x20, 0x20, 0x20, 0xFF); // Some nice gray, taken from QRaken
-    constexpr u32 textColor = C2D_Color32f(1,1,1,1); // White
+    constexpr u32 backgroundColor = Platform::color32(0x20, 0x20, 0x20, 0xFF); // Some nice gray, taken from QRaken
+    constexpr u32 textColor = Platform::color32(0xFF, 0xFF, 0xFF, 0xFF); // White
 
     constexpr double textScale = 0.5f;
 
@@ -20,6 +36,28 @@ namespace Game
         int damage;
     } WaterProperty;
 
+    constexpr size_t WATER_TYPE_AMOUNT = 3;
+    typedef std::array<WaterProperty, WATER_TYPE_AMOUNT> WaterTypes;
+
+    // Bottom screen lines that change while playing, each parsed again only when its contents do
+    typedef enum
+    {
+        TEXT_GYROSCOPE,
+        TEXT_ACCELEROMETER,
+        TEXT_ANGLES,
+        TEXT_SPLASH_COUNT,
+
+        TEXT_SLOT_AMOUNT
+    } TextSlot;
+
+    // What the game schedules on its timer wheel
+    typedef enum
+    {
+        EVENT_SPAWN, // the regular splash, which schedules the next one
+        EVENT_BOSS,
+        EVENT_WAVE, // the argument is the index of the scripted spawn
+    } EventType;
+
     typedef enum
     {
         BEAM_NONE = -1,
@@ -29,27 +67,32 @@ namespace Game
         BEAM_TYPE_AMOUNT
     } BeamType;
 
+    // Thin view over one splash in a SplashPool, only valid until the pool is changed
     class PaintSplash
     {
         public:
-            PaintSplash(bool boss);
-            PaintSplash(double tX, double tY, double tZ);
+            PaintSplash(SplashPool& pool, SplashHandle handle);
+
+            // Regular splashes take one of the palette's colors when there is one, bosses always take a water's
+            // Anywhere, exactly at tX and tY, or scattered a little around tX, tY and tZ
+            static SplashHandle spawn(SplashPool& pool, Random& random, bool boss, const WaterTypes& waters, const u32* palette = NULL);
+            static SplashHandle spawnAt(SplashPool& pool, Random& random, float tX, float tY, bool boss, const WaterTypes& waters, const u32* palette = NULL);
+            static SplashHandle spawn(SplashPool& pool, Random& random, float tX, float tY, float tZ);
 
-            bool isInCenter(double tX, double tY, double tZ);
-            bool hit(const WaterProperty& water, int* damage);
+            // Only tX and tY count, like for quad: tZ follows the yaw the gyroscope drifts on, which doesn't move splashes on the screen
+            bool isInCenter(float tX, float tY);
 
-            bool isVisible(double tX, double tY, double tZ);
-            void draw(double tX, double tY, double tZ);
+            bool isVisible(float tX, float tY);
+            // Where and how the splash shows on the top screen when looking towards tX, tY, roll not turning the picture
+            Platform::Quad quad(float tX, float tY);
 
             bool isBoss();
-            void getAngles(double* tX, double* tY,double* tZ);
+            void getAngles(float* tX, float* tY,float* tZ);
             u32 getColor();
 
         private:
-            double tX, tY, tZ; // angle from normal
-            double health;
-            u32 color;
-            bool boss;
+            SplashPool& pool;
+            u32 index;
     };
 
     class Game
@@ -60,21 +103,74 @@ namespace Game
 
             void update();
 
+            // For checking replays against each other
+            int getHitCounter();
+            size_t getSplashCount();
+            u32 checksum();
+            const Startup& getStartup();
+
             bool running;
 
         private:
-            void drawCameraImage();
-            void drawPaintSplashes();
-            void drawHitCounter();
-            void drawOverlay();
+            // Everything the constructor brings up, each one a startup task
+            typedef struct
+            {
+                Game* game;
+                int argc;
+                char** argv;
+            } StartupArguments;
+
+            static void initSystemTask(void* data);
+            static void initSensorsTask(void* data);
+            static void initConversionTask(void* data);
+            static void startCameraTask(void* data);
+            static void loadSpritesTask(void* data);
+            static void prepareTextTask(void* data);
+            static void buildHudTask(void* data);
+            static void startSessionTask(void* data);
+
+            Startup startup;
+            bool cameraShown; // a placeholder is drawn until the camera's first picture comes
+
+            // The top screen is drawn once per eye, slider is how far apart the eyes' pictures go
+            void drawCameraImage(Stereo::Eye eye);
+            void drawDecals(Stereo::Eye eye, float slider);
+            void drawPaintSplashes(Stereo::Eye eye, float slider);
+            void drawOverlay(Stereo::Eye eye, float slider);
             void drawText();
+            void drawMinimap();
 
             void draw();
-
-            void lockOn(PaintSplash* paintSplash);
-
-            void addText(C2D_TextBuf textBuf, const char* text);
-
+            void runFrameJobs(u32 eyes);
+            void setStereo(bool stereo);
+            void setHardwareConversion(bool enabled);
+            Platform::CameraMode cameraMode();
+            void updateCamera();
+
+            static void convertCameraJob(void* data);
+            static void flushCameraJob(void* data);
+            static void convertCameraTextureJob(void* data);
+            static void cullSplashesJob(void* data);
+            static void stitchPanoramaJob(void* data);
+            static void blendDecalsJob(void* data);
+
+            void buildHud();
+            void updateHud();
+
+            void lockOn(SplashHandle paintSplash);
+            void updateCameraAngles();
+
+            bool nextFrame(Recording::Frame* frame);
+            void simulate(const Recording::Frame& frame);
+            void step(const Recording::Frame& frame);
+            void updateView();
+            void loadWaves(const char* path);
+            void runEvent(const TimerWheel::Event& event, const Recording::Frame& frame);
+
+            Recording::Writer recorder;
+            Recording::Reader replay;
+
+            WaterTypes waters; // the session's, their colors changed by stealing
             int selectedWater;
             u32 waterLevel;
             bool firing;
@@ -83,19 +179,70 @@ namespace Game
             int hitCounter, lastBossSpawn;
             int lastDamage;
 
-            angularRate rate;
-            accelVector vector;
-
-            double tX, tY, tZ; // Camera angle from normal
-            std::vector<PaintSplash*> paintSplashes;
-
-            u32 old_time_limit;
-
-            int frameCounter;
-            u64 lastTime;
-
-            C3D_RenderTarget *top, *bottom;
-            C2D_TextBuf staticBuf, dynamicBuf;
-            std::vector<C2D_Text*> text;
+            Recording::Frame lastFrame;
+
+            Orientation orientation;
+            float aimX, aimY; // Manual aiming on top of the orientation, from the D-pad and boss lock-on
+            float previousAimX, previousAimY; // before the last step
+            float tX, tY, tZ; // Camera angle from normal
+            float viewX, viewY; // what the top screen shows, the camera angle with the aim between the last two steps
+            SplashPool paintSplashes;
+            AngularGrid<SplashHandle> splashGrid;
+            std::vector<SplashHandle> queriedSplashes; // scratch space for splashGrid queries
+            std::vector<SplashHandle> visibleSplashes; // scratch space for cullSplashesJob
+            std::vector<SplashHandle> killedSplashes; // scratch space for damageTable.hit
+            DamageTable damageTable; // kept up with waters
+            FrameArena frameArena; // emptied at the start of every draw
+            Platform::Quad* splashQuads; // built by cullSplashesJob from the visible splashes, in the frame arena
+            u32 splashQuadCount;
+            Platform::DrawList splashList; // splashQuads, for both eyes
+            // Paint left by every splash killed, blended into its texture once per frame
+            DecalLayer* decals;
+            Platform::Texture decalTexture;
+
+            JobSystem* jobs;
+            static constexpr u32 CAMERA_JOBS = 6; // per eye
+            typedef struct
+            {
+                Game* game;
+                Stereo::Eye eye;
+                u32 firstTileRow, tileRows;
+            } CameraBand;
+            CameraBand cameraBands[Stereo::EYE_AMOUNT][CAMERA_JOBS];
+
+            bool stereo; // both cameras are captured, and the right eye is drawn while the 3D slider is up
+            // The camera gives YUV422 for the Y2R unit to convert, instead of RGB565 for the CPU to swizzle
+            // Turned off for good once the unit fails, the frame it failed on being converted on the CPU
+            bool hardwareConversion;
+            bool conversionFailed;
+
+            // What the camera saw all around, kept up a few tiles per converted frame, and shown as a minimap
+            Panorama* panorama;
+            Platform::Texture panoramaTexture;
+
+            CaptureGovernor governor;
+            u64 frameWaitTicks; // spent in the last draw waiting for the previous frame to be shown
+            u32 drawnFrames;
+
+            void addPaintSplash(SplashHandle paintSplash);
+            void removePaintSplash(SplashHandle paintSplash);
+
+            // Steps run for the time the frames cover, at STEP_RATE whatever the frame rate
+            u64 steps;
+            u64 lastTick; // of the last frame, 0 before the first
+            u64 accumulatedTicks; // not run yet, less than a step once a frame is done
+            u32 pendingKeysDown; // for the next step
+
+            // Spawns are scheduled in SCHEDULE_RATE ticks from the first step, and only draw from spawnRandom
+            Random spawnRandom;
+            TimerWheel events;
+            std::vector<TimerWheel::Event> dueEvents; // scratch space for events.advance
+            std::vector<Waves::Spawn> waveSpawns;
+            u32 wavesChecksum; // 0 without a script
+
+            std::vector<Platform::Text> text;
+            TextCache textCache;
+            Platform::DrawList hud;
+            std::vector<Platform::Quad> hudQuads; // what was last given to the draw list
     };
 }
@@ -0,0 +1,150 @@
+#include "jobs.h"
+
+JobSystem::JobSystem(u32 workerCount) : workerCount(workerCount), jobCount(0), remaining(0), stolen(0), stop(false)
+{
+    this->queues = new Queue[workerCount + 1];
+    for(u32 i = 0; i <= workerCount; i++)
+        this->queues[i].front = this->queues[i].back = 0;
+
+    u32 cores = Platform::coreCount();
+    this->workers = new Worker[workerCount];
+    for(u32 i = 0; i < workerCount; i++)
+    {
+        Worker* worker = &this->workers[i];
+        worker->system = this;
+        worker->index = i + 1;
+        worker->thread = Platform::createThread(workerMain, worker, 0x4000, 0x2F, (i + 1) % cores);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    this->stop = true;
+    this->wake.release(this->workerCount);
+    for(u32 i = 0; i < this->workerCount; i++)
+        if(this->workers[i].thread != NULL)
+            Platform::joinThread(this->workers[i].thread);
+
+    delete[] this->workers;
+    delete[] this->queues;
+}
+
+JobSystem::JobId JobSystem::add(void (*function)(void* data), void* data)
+{
+    if(this->jobCount == MAX_JOBS)
+        return INVALID_JOB;
+
+    Job& job = this->jobs[this->jobCount];
+    job.function = function;
+    job.data = data;
+    job.pending.store(0, std::memory_order_relaxed);
+    job.dependentCount = 0;
+    return this->jobCount++;
+}
+
+bool JobSystem::depend(JobId job, JobId on)
+{
+    if(job >= this->jobCount || on >= this->jobCount || this->jobs[on].dependentCount == MAX_DEPENDENTS)
+        return false;
+
+    Job& dependency = this->jobs[on];
+    dependency.dependents[dependency.dependentCount++] = job;
+    this->jobs[job].pending.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void JobSystem::run()
+{
+    if(this->jobCount == 0)
+        return;
+
+    // Workers start on the first pushed job right away and may make others ready, so pick the ready ones beforehand
+    JobId ready[MAX_JOBS];
+    u32 readyCount = 0;
+    for(JobId job = 0; job < this->jobCount; job++)
+        if(this->jobs[job].pending.load(std::memory_order_relaxed) == 0)
+            ready[readyCount++] = job;
+
+    this->remaining.store(this->jobCount, std::memory_order_relaxed);
+    for(u32 i = 0; i < readyCount; i++)
+        this->push(0, ready[i]);
+
+    JobId job;
+    while(this->remaining.load(std::memory_order_acquire) != 0)
+    {
+        if(this->pop(0, &job) || this->steal(0, &job))
+            this->execute(0, job);
+        else
+            Platform::sleep(0);
+    }
+    this->jobCount = 0;
+}
+
+void JobSystem::workerMain(void* arg)
+{
+    Worker* worker = (Worker*)arg;
+    JobSystem* system = worker->system;
+    JobId job;
+    while(true)
+    {
+        system->wake.acquire();
+        if(system->stop)
+            break;
+
+        while(system->pop(worker->index, &job) || system->steal(worker->index, &job))
+            system->execute(worker->index, job);
+    }
+}
+
+void JobSystem::push(u32 queue, JobId job)
+{
+    Queue& target = this->queues[queue];
+    target.lock.lock();
+    target.jobs[target.back++ % MAX_JOBS] = job;
+    target.lock.unlock();
+    this->wake.release();
+}
+
+bool JobSystem::pop(u32 queue, JobId* job)
+{
+    Queue& source = this->queues[queue];
+    source.lock.lock();
+    bool found = source.back != source.front;
+    if(found)
+        *job = source.jobs[--source.back % MAX_JOBS];
+    source.lock.unlock();
+    return found;
+}
+
+bool JobSystem::steal(u32 thief, JobId* job)
+{
+    for(u32 i = 1; i <= this->workerCount; i++)
+    {
+        Queue& victim = this->queues[(thief + i) % (this->workerCount + 1)];
+        victim.lock.lock();
+        bool found = victim.back != victim.front;
+        if(found)
+            *job = victim.jobs[victim.front++ % MAX_JOBS];
+        victim.lock.unlock();
+        if(found)
+        {
+            this->stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Jobs made ready by this one go on the same thread's queue, where their inputs are likely still in cache
+void JobSystem::execute(u32 queue, JobId id)
+{
+    Job& job = this->jobs[id];
+    job.function(job.data);
+    for(u32 i = 0; i < job.dependentCount; i++)
+    {
+        JobId dependent = job.dependents[i];
+        if(this->jobs[dependent].pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            this->push(queue, dependent);
+    }
+    this->remaining.fetch_sub(1, std::memory_order_release);
+}
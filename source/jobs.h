@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.h"
+#include <atomic>
+
+// Runs a small graph of jobs spread over every core the game may use, rebuilt every frame
+// The thread calling run works too. Each thread has its own queue, takes its newest jobs first,
+// and steals the oldest jobs of the others when its own queue is empty
+class JobSystem
+{
+    public:
+        typedef u32 JobId;
+        static constexpr u32 MAX_JOBS = 64;
+        static constexpr u32 MAX_DEPENDENTS = 8;
+        static constexpr JobId INVALID_JOB = UINT32_MAX;
+
+        // workerCount threads besides the one calling run, the worker i goes on core i+1 modulo the core count
+        JobSystem(u32 workerCount);
+        ~JobSystem();
+
+        // INVALID_JOB once MAX_JOBS have been added since the last run
+        JobId add(void (*function)(void* data), void* data);
+        // job won't start before on has finished
+        // Leaves both alone and returns false if either isn't a job, or on already has MAX_DEPENDENTS
+        bool depend(JobId job, JobId on);
+
+        // Runs every job added since the last call and returns once they're all done
+        void run();
+
+        u32 threadCount() const { return this->workerCount + 1; }
+        u32 stolenCount() const { return this->stolen.load(std::memory_order_relaxed); }
+
+    private:
+        typedef struct
+        {
+            void (*function)(void* data);
+            void* data;
+            std::atomic<u32> pending; // dependencies not finished yet
+            JobId dependents[MAX_DEPENDENTS];
+            u32 dependentCount;
+        } Job;
+
+        // Owner pushes and pops at the back, thieves take from the front
+        typedef struct
+        {
+            Platform::Mutex lock;
+            JobId jobs[MAX_JOBS];
+            u32 front, back;
+        } Queue;
+
+        typedef struct
+        {
+            JobSystem* system;
+            u32 index;
+            Platform::Thread thread;
+        } Worker;
+
+        static void workerMain(void* arg);
+
+        void push(u32 queue, JobId job);
+        bool pop(u32 queue, JobId* job);
+        bool steal(u32 thief, JobId* job);
+        void execute(u32 queue, JobId job);
+
+        u32 workerCount;
+        Worker* workers;
+        Queue* queues; // one per thread, the caller of run has the first one
+
+        Job jobs[MAX_JOBS];
+        u32 jobCount;
+        std::atomic<u32> remaining;
+        std::atomic<u32> stolen;
+
+        Platform::Semaphore wake; // released once per job pushed, spare releases only cost a look around
+        volatile bool stop;
+};
@@ -2,13 +2,13 @@
 
 int main(int argc, char* argv[])
 {
-    consoleDebugInit(debugDevice_SVC);
-    auto game = new Game::Game(argc, argv);
+    auto game = Memory::create<Game::Game>(Memory::TAG_GAME, argc, argv);
 
-    while(aptMainLoop() && game->running)
+    while(Platform::mainLoop() && game->running)
         game->update();
 
-    delete game;
+    Memory::destroy(Memory::TAG_GAME, game);
+    Memory::report();
 
     return 0;
 }
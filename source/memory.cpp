@@ -0,0 +1,105 @@
+#include "memory.h"
+#include "common.h"
+#include <cstdlib>
+#include <atomic>
+
+namespace Memory
+{
+    static constexpr size_t KB = 1024;
+
+    // Room for what the game allocates now with some to spare
+    static TagInfo tags[TAG_AMOUNT] = {
+        {"render targets", REGION_VRAM, 3072*KB},
+        {"graphics", REGION_LINEAR, 4096*KB},
+        {"camera frames", REGION_LINEAR, 1280*KB},
+        {"textures", REGION_LINEAR, 1024*KB},
+        {"text", REGION_HEAP, 256*KB},
+        {"camera", REGION_HEAP, 256*KB},
+        {"panorama", REGION_HEAP, 160*KB},
+        {"game", REGION_HEAP, 1024*KB},
+        {"frame", REGION_HEAP, 128*KB},
+    };
+
+    static const char* const REGION_NAMES[REGION_AMOUNT] = {"heap", "linear", "vram"};
+
+    static std::atomic<size_t> usedBytes[TAG_AMOUNT];
+    static std::atomic<size_t> peakBytes[TAG_AMOUNT];
+
+    static void defaultFailure(Tag tag, size_t needed, size_t budget)
+    {
+        DEBUG("memory: %s needs %lu bytes, over its budget of %lu\n", tags[tag].name, (unsigned long)needed, (unsigned long)budget);
+        report();
+        abort();
+    }
+
+    static FailureHandler failureHandler = defaultFailure;
+
+    const TagInfo& info(Tag tag)
+    {
+        return tags[tag];
+    }
+
+    void setBudget(Tag tag, size_t budget)
+    {
+        tags[tag].budget = budget;
+    }
+
+    void account(Tag tag, size_t bytes)
+    {
+        size_t used = usedBytes[tag].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = peakBytes[tag].load(std::memory_order_relaxed);
+        while(used > peak && !peakBytes[tag].compare_exchange_weak(peak, used, std::memory_order_relaxed));
+        if(used > tags[tag].budget)
+            fail(tag, used, tags[tag].budget);
+    }
+
+    void release(Tag tag, size_t bytes)
+    {
+        size_t used = usedBytes[tag].load(std::memory_order_relaxed);
+        while(!usedBytes[tag].compare_exchange_weak(used, used - (bytes < used ? bytes : used), std::memory_order_relaxed));
+    }
+
+    size_t used(Tag tag)
+    {
+        return usedBytes[tag];
+    }
+
+    size_t peak(Tag tag)
+    {
+        return peakBytes[tag];
+    }
+
+    size_t regionUsed(Region region)
+    {
+        size_t total = 0;
+        for(u32 tag = 0; tag < TAG_AMOUNT; tag++)
+            if(tags[tag].region == region)
+                total += usedBytes[tag];
+        return total;
+    }
+
+    void resetPeaks()
+    {
+        for(u32 tag = 0; tag < TAG_AMOUNT; tag++)
+            peakBytes[tag].store(usedBytes[tag].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    void setFailureHandler(FailureHandler handler)
+    {
+        failureHandler = handler ? handler : defaultFailure;
+    }
+
+    void fail(Tag tag, size_t needed, size_t budget)
+    {
+        failureHandler(tag, needed, budget);
+    }
+
+    void report()
+    {
+        for(u32 tag = 0; tag < TAG_AMOUNT; tag++)
+            DEBUG("memory: %-14s %-6s %8lu used %8lu peak %8lu budget\n", tags[tag].name, REGION_NAMES[tags[tag].region],
+                (unsigned long)usedBytes[tag].load(), (unsigned long)peakBytes[tag].load(), (unsigned long)tags[tag].budget);
+        for(u32 region = 0; region < REGION_AMOUNT; region++)
+            DEBUG("memory: %-6s %8lu used\n", REGION_NAMES[region], (unsigned long)regionUsed((Region)region));
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "types.h"
+#include <new>
+#include <utility>
+
+// Where the console's memory goes: every long lived allocation is counted against a tag, and each tag has a budget
+// in one of the regions, the regular heap, the linear heap the GPU and DMA read from, or VRAM
+// Going over a budget is a bug, it's reported and the game stops unless something else is set to handle it
+// Counting is safe from any thread, budgets and the failure handler are only set from the main one
+namespace Memory
+{
+    typedef enum
+    {
+        REGION_HEAP,
+        REGION_LINEAR,
+        REGION_VRAM,
+
+        REGION_AMOUNT
+    } Region;
+
+    typedef enum
+    {
+        TAG_RENDER_TARGETS, // the screens' color and depth buffers
+        TAG_GRAPHICS, // command buffer, 2D batches and sprite sheet
+        TAG_CAMERA_FRAMES, // what the cameras write into
+        TAG_TEXTURES,
+        TAG_TEXT, // parsed text and glyph buffers
+        TAG_CAMERA, // camera thread state, optical flow and palette
+        TAG_PANORAMA, // what the camera saw all around
+        TAG_GAME, // the game itself and its jobs
+        TAG_FRAME, // the frame arena
+
+        TAG_AMOUNT
+    } Tag;
+
+    typedef struct
+    {
+        const char* name;
+        Region region;
+        size_t budget; // in bytes
+    } TagInfo;
+
+    const TagInfo& info(Tag tag);
+    void setBudget(Tag tag, size_t budget);
+
+    void account(Tag tag, size_t bytes);
+    void release(Tag tag, size_t bytes);
+
+    size_t used(Tag tag);
+    size_t peak(Tag tag); // the most used at once since the start or the last resetPeaks
+    size_t regionUsed(Region region);
+    void resetPeaks();
+
+    // Called when a tag goes over its budget, or an arena or a pool of one runs out, given how much it needed
+    // The default one says so and aborts
+    typedef void (*FailureHandler)(Tag tag, size_t needed, size_t budget);
+    void setFailureHandler(FailureHandler handler);
+    void fail(Tag tag, size_t needed, size_t budget);
+
+    // Prints every tag's use, peak and budget, then every region's total
+    void report();
+
+    // new and delete for objects counted against a tag
+    template<typename T, typename... Args>
+    T* create(Tag tag, Args&&... args)
+    {
+        account(tag, sizeof(T));
+        return new T(std::forward<Args>(args)...);
+    }
+
+    template<typename T>
+    void destroy(Tag tag, T* object)
+    {
+        if(object == NULL)
+            return;
+        delete object;
+        release(tag, sizeof(T));
+    }
+}
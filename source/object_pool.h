@@ -0,0 +1,71 @@
+#pragma once
+
+#include "types.h"
+#include "memory.h"
+#include <new>
+#include <utility>
+
+// Room for a fixed number of objects of one type, taken once and counted against a tag,
+// handing slots out from a free list so creating and destroying them never goes through the heap
+template<typename T, u32 N>
+class ObjectPool
+{
+    public:
+        ObjectPool(Memory::Tag tag) : tag(tag), freeHead(0), count(0), highWater(0)
+        {
+            for(u32 i = 0; i < N; i++)
+                this->next[i] = i + 1;
+            Memory::account(tag, sizeof(*this));
+        }
+
+        ~ObjectPool()
+        {
+            Memory::release(this->tag, sizeof(*this));
+        }
+
+        // NULL once every slot is taken, which is reported as the pool's tag going over budget
+        template<typename... Args>
+        T* create(Args&&... args)
+        {
+            if(this->freeHead == N)
+            {
+                Memory::fail(this->tag, (N + 1)*sizeof(T), N*sizeof(T));
+                return NULL;
+            }
+
+            u32 slot = this->freeHead;
+            this->freeHead = this->next[slot];
+            this->count++;
+            if(this->count > this->highWater)
+                this->highWater = this->count;
+            return new(this->slots[slot].bytes) T(std::forward<Args>(args)...);
+        }
+
+        void destroy(T* object)
+        {
+            if(object == NULL)
+                return;
+
+            object->~T();
+            u32 slot = (Slot*)object - this->slots;
+            this->next[slot] = this->freeHead;
+            this->freeHead = slot;
+            this->count--;
+        }
+
+        u32 used() const { return this->count; }
+        u32 peak() const { return this->highWater; }
+        static constexpr u32 capacity() { return N; }
+
+    private:
+        struct Slot
+        {
+            alignas(T) u8 bytes[sizeof(T)];
+        };
+
+        Slot slots[N];
+        u32 next[N]; // free list, N ends it
+        Memory::Tag tag;
+        u32 freeHead;
+        u32 count, highWater;
+};
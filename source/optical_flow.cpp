@@ -0,0 +1,161 @@
+#include "optical_flow.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+// A block needs at least this much contrast, as a summed distance to its mean, to be matched reliably
+static constexpr u32 MIN_CONTRAST = OpticalFlow::BLOCK_SIZE*OpticalFlow::BLOCK_SIZE*4;
+static constexpr u32 MIN_BLOCKS = 3;
+
+static inline u32 load32(const u8* pixels)
+{
+    u32 word;
+    memcpy(&word, pixels, sizeof(word));
+    return word;
+}
+
+// Sum of absolute differences of the four bytes in a and b, added to accumulator
+static inline u32 sad4(u32 a, u32 b, u32 accumulator)
+{
+#ifdef __ARM_FEATURE_SIMD32
+    u32 result;
+    __asm__("usada8 %0, %1, %2, %3" : "=r"(result) : "r"(a), "r"(b), "r"(accumulator));
+    return result;
+#else
+    for(int i = 0; i < 32; i += 8)
+    {
+        int difference = (int)((a >> i) & 0xFF) - (int)((b >> i) & 0xFF);
+        accumulator += difference < 0 ? -difference : difference;
+    }
+    return accumulator;
+#endif
+}
+
+OpticalFlow::OpticalFlow()
+{
+    this->budgetTicks = Platform::TICKS_PER_SECOND*4/1000;
+    this->setArea(CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT);
+}
+
+void OpticalFlow::setArea(u32 width, u32 height, Platform::CameraFormat format)
+{
+    this->lumaWidth = width/SCALE;
+    this->lumaHeight = height/SCALE;
+    this->stride = width;
+    this->format = format;
+    this->reset();
+}
+
+void OpticalFlow::reset()
+{
+    this->current = 0;
+    this->hasPrevious = false;
+}
+
+// Averages the middle 2x2 pixels of every SCALExSCALE cell, reading a quarter of the frame
+// YUV422 frames already have the luma in every pixel's low byte
+void OpticalFlow::downsample(const u16* frame, u8* luma)
+{
+    bool yuv = this->format == Platform::CAMERA_YUV422;
+    for(u32 y = 0; y < this->lumaHeight; y++)
+    {
+        const u16* row = frame + (y*SCALE + SCALE/2 - 1)*this->stride + SCALE/2 - 1;
+        for(u32 x = 0; x < this->lumaWidth; x++, row += SCALE)
+        {
+            u32 sum = 0;
+            for(u32 i = 0; i < 4; i++)
+            {
+                u16 pixel = row[(i >> 1)*this->stride + (i & 1)];
+                if(yuv)
+                {
+                    sum += pixel & 0xFF;
+                    continue;
+                }
+                u32 r = pixel >> 11, g = (pixel >> 5) & 0x3F, b = pixel & 0x1F;
+                sum += (r*77*8 + g*150*4 + b*29*8) >> 8;
+            }
+            luma[y*WIDTH + x] = sum >> 2;
+        }
+    }
+}
+
+bool OpticalFlow::matchBlock(u32 blockX, u32 blockY, int* shiftX, int* shiftY)
+{
+    const u8* previous = this->luma[this->current ^ 1];
+    const u8* latest = this->luma[this->current];
+
+    const u8* block = previous + blockY*WIDTH + blockX;
+    u32 mean = 0;
+    for(u32 y = 0; y < BLOCK_SIZE; y++)
+        for(u32 x = 0; x < BLOCK_SIZE; x++)
+            mean += block[y*WIDTH + x];
+    mean /= BLOCK_SIZE*BLOCK_SIZE;
+
+    u32 contrast = 0;
+    for(u32 y = 0; y < BLOCK_SIZE; y++)
+        for(u32 x = 0; x < BLOCK_SIZE; x++)
+            contrast += std::abs((int)block[y*WIDTH + x] - (int)mean);
+    if(contrast < MIN_CONTRAST)
+        return false;
+
+    u32 bestSad = UINT32_MAX;
+    for(int dy = -SEARCH_RADIUS; dy <= SEARCH_RADIUS; dy++)
+    {
+        for(int dx = -SEARCH_RADIUS; dx <= SEARCH_RADIUS; dx++)
+        {
+            const u8* candidate = latest + (blockY + dy)*WIDTH + blockX + dx;
+            u32 sad = 0;
+            for(u32 y = 0; y < BLOCK_SIZE && sad < bestSad; y++)
+            {
+                sad = sad4(load32(block + y*WIDTH), load32(candidate + y*WIDTH), sad);
+                sad = sad4(load32(block + y*WIDTH + 4), load32(candidate + y*WIDTH + 4), sad);
+            }
+            if(sad < bestSad)
+            {
+                bestSad = sad;
+                *shiftX = dx;
+                *shiftY = dy;
+            }
+        }
+    }
+
+    // Nothing in the search area looks much like the block, it probably moved out of it or is something moving on its own
+    return bestSad < contrast/2;
+}
+
+bool OpticalFlow::update(const u16* frame, float* shiftX, float* shiftY)
+{
+    u64 start = Platform::ticks();
+    this->current ^= 1;
+    this->downsample(frame, this->luma[this->current]);
+    if(!this->hasPrevious)
+    {
+        this->hasPrevious = true;
+        return false;
+    }
+
+    // Blocks spread over the picture, far enough from its edges for the whole search area
+    const u32 spanX = this->lumaWidth - BLOCK_SIZE - 2*SEARCH_RADIUS;
+    const u32 spanY = this->lumaHeight - BLOCK_SIZE - 2*SEARCH_RADIUS;
+    int shiftsX[BLOCKS_X*BLOCKS_Y], shiftsY[BLOCKS_X*BLOCKS_Y];
+    u32 found = 0;
+    for(u32 i = 0; i < BLOCKS_X*BLOCKS_Y; i++)
+    {
+        if(Platform::ticks() - start > this->budgetTicks)
+            break;
+
+        u32 blockX = SEARCH_RADIUS + spanX*(i % BLOCKS_X)/(BLOCKS_X-1);
+        u32 blockY = SEARCH_RADIUS + spanY*(i / BLOCKS_X)/(BLOCKS_Y-1);
+        if(this->matchBlock(blockX, blockY, &shiftsX[found], &shiftsY[found]))
+            found++;
+    }
+
+    if(found < MIN_BLOCKS)
+        return false;
+
+    std::nth_element(shiftsX, shiftsX + found/2, shiftsX + found);
+    std::nth_element(shiftsY, shiftsY + found/2, shiftsY + found);
+    *shiftX = shiftsX[found/2]*(float)SCALE;
+    *shiftY = shiftsY[found/2]*(float)SCALE;
+    return true;
+}
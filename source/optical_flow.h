@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common.h"
+#include "camera.h"
+
+// Finds how far the picture moved between two camera frames, by matching a few textured blocks of a
+// downsampled luma copy against the previous frame and keeping the median of their shifts
+class OpticalFlow
+{
+    public:
+        static constexpr u32 SCALE = 4; // camera pixels per luma pixel, on each axis
+        static constexpr u32 WIDTH = CAMERA_BUFFER_WIDTH/SCALE; // luma rows are this far apart whatever the picture's size
+        static constexpr u32 HEIGHT = CAMERA_BUFFER_HEIGHT/SCALE;
+        static constexpr u32 BLOCK_SIZE = 8;
+        static constexpr int SEARCH_RADIUS = 6; // in luma pixels, so up to 24 camera pixels per frame
+        static constexpr u32 BLOCKS_X = 4, BLOCKS_Y = 3;
+
+        OpticalFlow();
+
+        // Shift of the picture since the previous frame, in camera pixels, positive to the right and down
+        // Fails on the first frame, when too few blocks had texture to match, or when the budget ran out first
+        bool update(const u16* frame, float* shiftX, float* shiftY);
+        void reset();
+        // Size and format of the packed pictures in the frames, starts over as the next frame can't be compared with the last
+        void setArea(u32 width, u32 height, Platform::CameraFormat format = Platform::CAMERA_RGB565);
+
+        u64 budgetTicks; // blocks left once this much time was spent are skipped
+
+    private:
+        void downsample(const u16* frame, u8* luma);
+        bool matchBlock(u32 blockX, u32 blockY, int* shiftX, int* shiftY);
+
+        u8 luma[2][WIDTH*HEIGHT];
+        u32 lumaWidth, lumaHeight; // the part of luma the picture covers
+        u32 stride; // between the frames' rows, in pixels
+        Platform::CameraFormat format;
+        u32 current;
+        bool hasPrevious;
+};
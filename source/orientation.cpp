@@ -0,0 +1,182 @@
+#include "orientation.h"
+#include "fast_math.h"
+#include <cmath>
+#include <algorithm>
+
+// Accelerometer readings outside of this range are mostly the player moving, not gravity
+static constexpr float MIN_GRAVITY = 0.5f;
+static constexpr float MAX_GRAVITY = 2.0f;
+
+Orientation::Orientation(u64 ticksPerSecond) : ticksPerSecond(ticksPerSecond)
+{
+    this->reset();
+}
+
+void Orientation::reset()
+{
+    this->started = false;
+    this->lastTick = 0;
+    this->w = 1.0f;
+    this->x = this->y = this->z = 0.0f;
+    this->biasX = this->biasY = this->biasZ = 0.0f;
+    this->dropVisualRotation();
+}
+
+void Orientation::applyVisualRotation(float angleX, float angleY)
+{
+    constexpr float RADIANS_PER_DEGREE = 1.0f/FastMath::DEGREES_PER_RADIAN;
+    if(this->gyroTime <= 0)
+        return;
+
+    float ex = angleX*RADIANS_PER_DEGREE - this->gyroAngleX;
+    float ey = angleY*RADIANS_PER_DEGREE - this->gyroAngleY;
+
+    this->biasX += this->visualIntegralGain*ex/this->gyroTime;
+    this->biasY += this->visualIntegralGain*ey/this->gyroTime;
+
+    // q *= (1, e/2), small enough for the first order rotation
+    float hx = this->visualGain*ex/2, hy = this->visualGain*ey/2;
+    float qw = this->w, qx = this->x, qy = this->y, qz = this->z;
+    this->w = qw - qx*hx - qy*hy;
+    this->x = qx + qw*hx - qz*hy;
+    this->y = qy + qw*hy + qz*hx;
+    this->z = qz + qx*hy - qy*hx;
+
+    float norm = 1.0f/std::sqrt(this->w*this->w + this->x*this->x + this->y*this->y + this->z*this->z);
+    this->w *= norm;
+    this->x *= norm;
+    this->y *= norm;
+    this->z *= norm;
+
+    this->dropVisualRotation();
+}
+
+void Orientation::dropVisualRotation()
+{
+    this->gyroAngleX = this->gyroAngleY = this->gyroTime = 0.0f;
+}
+
+void Orientation::update(const Sample& sample)
+{
+    if(!this->started)
+    {
+        this->initializeFromAccel(sample.accel);
+        this->lastTick = sample.tick;
+        this->started = true;
+        return;
+    }
+
+    // Samples older than the last one carry no time to integrate over
+    if(sample.tick <= this->lastTick)
+        return;
+
+    float dt = (float)(sample.tick - this->lastTick)/this->ticksPerSecond;
+    this->lastTick = sample.tick;
+    if(dt > this->maxStep)
+        dt = this->maxStep;
+
+    // A gap just over the substep from rounding in the ticks isn't worth a piece of its own
+    u32 pieces = this->substep > 0 ? std::max(1, (int)std::ceil(dt/this->substep - 0.01f)) : 1;
+    for(u32 i = 0; i < pieces; i++)
+        this->integrate(sample, dt/pieces);
+}
+
+void Orientation::update(const Sample* samples, u32 count)
+{
+    for(u32 i = 0; i < count; i++)
+        this->update(samples[i]);
+}
+
+void Orientation::initializeFromAccel(const float accel[3])
+{
+    float magnitude = std::sqrt(accel[0]*accel[0] + accel[1]*accel[1] + accel[2]*accel[2]);
+    if(magnitude < MIN_GRAVITY || magnitude > MAX_GRAVITY)
+        return;
+
+    // Pitch and roll that put gravity where the accelerometer sees it, no yaw
+    float halfPitch = FastMath::atan2Degrees(accel[1], accel[2])/2;
+    float halfRoll = FastMath::atan2Degrees(-accel[0], std::sqrt(accel[1]*accel[1] + accel[2]*accel[2]))/2;
+    float cosPitch = FastMath::cosDegrees(halfPitch), sinPitch = FastMath::sinDegrees(halfPitch);
+    float cosRoll = FastMath::cosDegrees(halfRoll), sinRoll = FastMath::sinDegrees(halfRoll);
+    this->w = cosPitch*cosRoll;
+    this->x = sinPitch*cosRoll;
+    this->y = cosPitch*sinRoll;
+    this->z = -sinPitch*sinRoll;
+}
+
+void Orientation::integrate(const Sample& sample, float dt)
+{
+    constexpr float RADIANS_PER_DEGREE = 1.0f/FastMath::DEGREES_PER_RADIAN;
+    float gx = sample.gyro[0]*RADIANS_PER_DEGREE;
+    float gy = sample.gyro[1]*RADIANS_PER_DEGREE;
+    float gz = sample.gyro[2]*RADIANS_PER_DEGREE;
+
+    float ax = sample.accel[0], ay = sample.accel[1], az = sample.accel[2];
+    float magnitude = std::sqrt(ax*ax + ay*ay + az*az);
+    if(magnitude > MIN_GRAVITY && magnitude < MAX_GRAVITY)
+    {
+        ax /= magnitude;
+        ay /= magnitude;
+        az /= magnitude;
+
+        // Where gravity should be according to the current attitude
+        float vx = 2*(this->x*this->z - this->w*this->y);
+        float vy = 2*(this->w*this->x + this->y*this->z);
+        float vz = this->w*this->w - this->x*this->x - this->y*this->y + this->z*this->z;
+
+        // The cross product is the rotation that would bring it to the measured one
+        float ex = ay*vz - az*vy;
+        float ey = az*vx - ax*vz;
+        float ez = ax*vy - ay*vx;
+
+        if(this->integralGain > 0)
+        {
+            this->biasX += this->integralGain*ex*dt;
+            this->biasY += this->integralGain*ey*dt;
+            this->biasZ += this->integralGain*ez*dt;
+        }
+
+        gx += this->proportionalGain*ex + this->biasX;
+        gy += this->proportionalGain*ey + this->biasY;
+        gz += this->proportionalGain*ez + this->biasZ;
+    }
+
+    this->gyroAngleX += gx*dt;
+    this->gyroAngleY += gy*dt;
+    this->gyroTime += dt;
+
+    // q += q * (0, g) * dt/2
+    float halfDt = dt/2;
+    float qw = this->w, qx = this->x, qy = this->y, qz = this->z;
+    this->w += (-qx*gx - qy*gy - qz*gz)*halfDt;
+    this->x += (qw*gx + qy*gz - qz*gy)*halfDt;
+    this->y += (qw*gy - qx*gz + qz*gx)*halfDt;
+    this->z += (qw*gz + qx*gy - qy*gx)*halfDt;
+
+    float norm = 1.0f/std::sqrt(this->w*this->w + this->x*this->x + this->y*this->y + this->z*this->z);
+    this->w *= norm;
+    this->x *= norm;
+    this->y *= norm;
+    this->z *= norm;
+}
+
+float Orientation::pitch() const
+{
+    return FastMath::atan2Degrees(2*(this->w*this->x + this->y*this->z), 1 - 2*(this->x*this->x + this->y*this->y));
+}
+
+float Orientation::roll() const
+{
+    float sine = 2*(this->w*this->y - this->x*this->z);
+    if(sine > 1.0f)
+        sine = 1.0f;
+    else if(sine < -1.0f)
+        sine = -1.0f;
+    // asin, through the function that's already fast
+    return FastMath::atan2Degrees(sine, std::sqrt(1 - sine*sine));
+}
+
+float Orientation::yaw() const
+{
+    return FastMath::atan2Degrees(2*(this->w*this->z + this->x*this->y), 1 - 2*(this->y*this->y + this->z*this->z));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.h"
+
+// Mahony filter keeping the device attitude as a unit quaternion
+// The gyroscope is integrated over the real time between samples, and the accelerometer slowly
+// pulls pitch and roll back towards gravity so gyroscope drift doesn't build up on those two axes
+class Orientation
+{
+    public:
+        // Axes are the accelerometer's, the gyroscope rates have to be remapped to match
+        typedef struct
+        {
+            u64 tick;
+            float gyro[3]; // angular rate around x, y and z, in degrees per second
+            float accel[3]; // in G
+        } Sample;
+
+        Orientation(u64 ticksPerSecond);
+
+        void update(const Sample& sample);
+        void update(const Sample* samples, u32 count);
+
+        // Forgets the attitude, the next sample starts over from its accelerometer reading
+        void reset();
+
+        // Rotation the camera saw around x and y since the last call, in degrees
+        // Whatever the gyroscope disagrees with is corrected, including yaw which gravity can't help with
+        void applyVisualRotation(float angleX, float angleY);
+        // The camera lost track, the gyroscope's rotation since the last call can't be checked
+        void dropVisualRotation();
+
+        // In degrees: pitch around x, roll around y and yaw around z, applied yaw first
+        float pitch() const;
+        float roll() const;
+        float yaw() const;
+
+        float proportionalGain = 0.6f; // how fast the accelerometer corrects, per second
+        float integralGain = 0.01f; // how fast the gyroscope bias estimate follows
+        float maxStep = 0.1f; // longer gaps between samples are clamped to this many seconds
+        float substep = 0.0f; // gaps are integrated in pieces at most this many seconds long, so the filter settles the same at any sample rate, 0 for whole
+        float visualGain = 0.5f; // share of the camera's disagreement corrected at once
+        float visualIntegralGain = 0.2f; // share of it attributed to gyroscope bias
+
+    private:
+        void initializeFromAccel(const float accel[3]);
+        void integrate(const Sample& sample, float dt);
+
+        u64 ticksPerSecond, lastTick;
+        bool started;
+
+        float w, x, y, z;
+        float biasX, biasY, biasZ; // integral feedback, in radians per second
+        float gyroAngleX, gyroAngleY, gyroTime; // rotation integrated since the last visual correction, in radians, and over how long
+};
@@ -0,0 +1,134 @@
+#include "palette.h"
+#include "yuv.h"
+#include <algorithm>
+#include <numeric>
+
+// Coprime with the tile count, so stepping by it visits every tile before coming back, spread over the whole picture
+// Being prime, it stays coprime with the smaller pictures' counts as long as they aren't multiples of it
+static constexpr u32 TILE_STRIDE = 37;
+static_assert(std::gcd(TILE_STRIDE, Palette::TILE_COUNT) == 1);
+
+// Weights are scaled back down before they lose precision
+static constexpr float MAX_SAMPLE_WEIGHT = 1e6f;
+
+Palette::Palette()
+{
+    this->setArea(CAMERA_BUFFER_WIDTH, CAMERA_BUFFER_HEIGHT);
+    this->reset();
+}
+
+void Palette::setArea(u32 width, u32 height, Platform::CameraFormat format)
+{
+    this->format = format;
+    this->stride = width;
+    this->tilesX = width/TILE_SIZE;
+    this->tileCount = this->tilesX*(height/TILE_SIZE);
+    this->nextTile = 0;
+}
+
+void Palette::reset()
+{
+    std::fill(this->weights, this->weights + BIN_COUNT, 0.0f);
+    std::fill(&this->sums[0][0], &this->sums[0][0] + BIN_COUNT*3, 0.0f);
+    this->sampleWeight = 1.0f;
+    this->nextTile = 0;
+}
+
+void Palette::normalize()
+{
+    float scale = 1.0f/this->sampleWeight;
+    for(u32 i = 0; i < BIN_COUNT; i++)
+    {
+        this->weights[i] *= scale;
+        this->sums[i][0] *= scale;
+        this->sums[i][1] *= scale;
+        this->sums[i][2] *= scale;
+    }
+    this->sampleWeight = 1.0f;
+}
+
+void Palette::update(const u16* frame)
+{
+    this->sampleWeight /= this->decay;
+    if(this->sampleWeight > MAX_SAMPLE_WEIGHT)
+        this->normalize();
+
+    for(u32 i = 0; i < this->tilesPerFrame; i++)
+    {
+        u32 tileX = this->nextTile % this->tilesX, tileY = this->nextTile / this->tilesX;
+        this->nextTile = (this->nextTile + TILE_STRIDE) % this->tileCount;
+
+        const u16* tile = frame + tileY*TILE_SIZE*this->stride + tileX*TILE_SIZE;
+        u32 r, g, b;
+        if(this->format == Platform::CAMERA_YUV422)
+            this->averageYuv422(tile, &r, &g, &b);
+        else
+            this->averageRgb565(tile, &r, &g, &b);
+
+        constexpr u32 SHIFT = 8 - CHANNEL_BITS;
+        u32 bin = (r >> SHIFT) << (CHANNEL_BITS*2) | (g >> SHIFT) << CHANNEL_BITS | (b >> SHIFT);
+        this->weights[bin] += this->sampleWeight;
+        this->sums[bin][0] += r*this->sampleWeight;
+        this->sums[bin][1] += g*this->sampleWeight;
+        this->sums[bin][2] += b*this->sampleWeight;
+    }
+}
+
+// 8 bits per channel, from the sum of 64 5 or 6 bit values
+void Palette::averageRgb565(const u16* tile, u32* r, u32* g, u32* b)
+{
+    u32 sumR = 0, sumG = 0, sumB = 0;
+    for(u32 y = 0; y < TILE_SIZE; y++, tile += this->stride)
+    {
+        for(u32 x = 0; x < TILE_SIZE; x++)
+        {
+            sumR += tile[x] >> 11;
+            sumG += (tile[x] >> 5) & 0x3F;
+            sumB += tile[x] & 0x1F;
+        }
+    }
+    *r = (sumR*255)/(31*TILE_SIZE*TILE_SIZE);
+    *g = (sumG*255)/(63*TILE_SIZE*TILE_SIZE);
+    *b = (sumB*255)/(31*TILE_SIZE*TILE_SIZE);
+}
+
+// The conversion is affine until it clamps, so converting the averages is close enough to averaging the converted pixels
+void Palette::averageYuv422(const u16* tile, u32* r, u32* g, u32* b)
+{
+    u32 sumY = 0, sumU = 0, sumV = 0;
+    for(u32 y = 0; y < TILE_SIZE; y++, tile += this->stride)
+    {
+        for(u32 x = 0; x < TILE_SIZE; x += 2)
+        {
+            sumY += (tile[x] & 0xFF) + (tile[x+1] & 0xFF);
+            sumU += tile[x] >> 8;
+            sumV += tile[x+1] >> 8;
+        }
+    }
+    constexpr u32 PAIRS = TILE_SIZE*TILE_SIZE/2;
+    u8 r8, g8, b8;
+    Yuv::toRgb(sumY/(PAIRS*2), sumU/PAIRS, sumV/PAIRS, &r8, &g8, &b8);
+    *r = r8;
+    *g = g8;
+    *b = b8;
+}
+
+u32 Palette::topColors(u32* colors, u32 count) const
+{
+    // A partial selection sort, count is expected to be a handful
+    u32 bins[BIN_COUNT];
+    u32 filled = 0;
+    for(u32 i = 0; i < BIN_COUNT; i++)
+        if(this->weights[i] > 0.0f)
+            bins[filled++] = i;
+
+    count = std::min(count, filled);
+    std::partial_sort(bins, bins + count, bins + filled, [this](u32 a, u32 b) { return this->weights[a] > this->weights[b]; });
+    for(u32 i = 0; i < count; i++)
+    {
+        const float* sum = this->sums[bins[i]];
+        float weight = this->weights[bins[i]];
+        colors[i] = Platform::color32(sum[0]/weight + 0.5f, sum[1]/weight + 0.5f, sum[2]/weight + 0.5f, 0xFF);
+    }
+    return count;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+#include "camera.h"
+
+// Most common colors in the camera picture, built up a few tiles per frame
+// Tile averages go into a coarse color histogram whose older contents fade away, so it follows the surroundings
+class Palette
+{
+    public:
+        static constexpr u32 TILE_SIZE = 8;
+        static constexpr u32 TILES_X = CAMERA_BUFFER_WIDTH/TILE_SIZE;
+        static constexpr u32 TILES_Y = CAMERA_BUFFER_HEIGHT/TILE_SIZE;
+        static constexpr u32 TILE_COUNT = TILES_X*TILES_Y; // for a full size picture
+        static constexpr u32 CHANNEL_BITS = 3;
+        static constexpr u32 BIN_COUNT = 1 << (CHANNEL_BITS*3);
+
+        Palette();
+
+        // Samples the next tilesPerFrame tiles and fades everything seen before by decay
+        void update(const u16* frame);
+        void reset();
+        // Size and format of the packed pictures in the frames, what was seen so far is kept
+        void setArea(u32 width, u32 height, Platform::CameraFormat format = Platform::CAMERA_RGB565);
+
+        // Average color of the fullest bins, fullest first, as color32; returns how many were filled
+        u32 topColors(u32* colors, u32 count) const;
+
+        u32 tilesPerFrame = 64;
+        float decay = 0.98f; // per update, about a second and a half to halve at 30 frames per second
+
+    private:
+        void normalize();
+        void averageRgb565(const u16* tile, u32* r, u32* g, u32* b);
+        void averageYuv422(const u16* tile, u32* r, u32* g, u32* b);
+
+        // Fading is done by making new samples weigh more instead of going over every bin each update
+        float weights[BIN_COUNT];
+        float sums[BIN_COUNT][3];
+        float sampleWeight;
+        u32 tilesX, tileCount;
+        u32 stride; // between the frames' rows, in pixels
+        Platform::CameraFormat format;
+        u32 nextTile;
+};
@@ -0,0 +1,137 @@
+#include "panorama.h"
+#include "swizzle.h"
+#include "yuv.h"
+#include <algorithm>
+#include <cmath>
+
+// The game draws what is angle degrees away at (sin(angle) + 1) half screens from the edge, so only the half turn in front shows
+static constexpr float HALF_VIEW = 90.0f;
+static constexpr float TILE_ANGLE = Panorama::TILE_SIZE*Panorama::PIXEL_ANGLE;
+
+Panorama::Panorama()
+{
+    this->reset();
+}
+
+// Every tile starts dirty, so the first upload clears the texture
+void Panorama::reset()
+{
+    std::fill(this->image, this->image + SIZE*SIZE, 0);
+    this->dirty = TILE_COUNT == 64 ? ~0ull : (1ull << TILE_COUNT) - 1;
+    this->seen = 0;
+    this->cursor = 0;
+}
+
+// A tile is covered when its closest edge is less than HALF_VIEW from the view on both axes
+u64 Panorama::covered(float tX, float tY)
+{
+    u64 columns = 0, rows = 0;
+    for(u32 i = 0; i < TILES; i++)
+    {
+        float center = -180.0f + (i + 0.5f)*TILE_ANGLE;
+        if(std::abs(FastMath::wrapDegrees(center - tY)) - TILE_ANGLE/2 < HALF_VIEW)
+            columns |= 1ull << i;
+        if(std::abs(FastMath::wrapDegrees(center - tX)) - TILE_ANGLE/2 < HALF_VIEW)
+            rows |= 1ull << i;
+    }
+
+    u64 tiles = 0;
+    for(u32 y = 0; y < TILES; y++)
+        if(rows >> y & 1)
+            tiles |= columns << (y*TILES);
+    return tiles;
+}
+
+// Pictures are scaled to the screen's width and centered on it, like drawCameraImage does, -1 marks what the frame doesn't show
+u32 Panorama::stitch(const u16* frame, u32 width, u32 height, Platform::CameraFormat format, float tX, float tY, u64 budgetTicks)
+{
+    u64 tiles = covered(tX, tY);
+    if(tiles == 0)
+        return 0;
+
+    u64 start = Platform::ticks();
+    s16 frameX[SIZE], frameY[SIZE];
+    for(u32 i = 0; i < SIZE; i++)
+    {
+        float angle = -180.0f + (i + 0.5f)*PIXEL_ANGLE;
+        float across = FastMath::wrapDegrees(angle - tY), down = FastMath::wrapDegrees(angle - tX);
+        frameX[i] = frameY[i] = -1;
+        if(std::abs(across) < HALF_VIEW)
+            frameX[i] = std::min<s32>((FastMath::sinDegrees(across) + 1.0f)*width/2, width - 1);
+        if(std::abs(down) < HALF_VIEW)
+        {
+            s32 y = FastMath::sinDegrees(down)*CAMERA_BUFFER_HEIGHT/2*width/CAMERA_BUFFER_WIDTH + height/2.0f;
+            if(y >= 0 && y < (s32)height)
+                frameY[i] = y;
+        }
+    }
+
+    u32 done = 0, first = this->cursor;
+    for(u32 i = 0; i < TILE_COUNT; i++)
+    {
+        u32 tile = (first + i) % TILE_COUNT;
+        if(!(tiles >> tile & 1))
+            continue;
+        if(done > 0 && Platform::ticks() - start >= budgetTicks)
+        {
+            this->cursor = tile;
+            return done;
+        }
+
+        this->stitchTile(tile, frame, width, format, frameX, frameY);
+        this->cursor = (tile + 1) % TILE_COUNT;
+        done++;
+    }
+    return done;
+}
+
+void Panorama::stitchTile(u32 tile, const u16* frame, u32 width, Platform::CameraFormat format, const s16* frameX, const s16* frameY)
+{
+    u32 left = (tile % TILES)*TILE_SIZE, top = (tile / TILES)*TILE_SIZE;
+    for(u32 y = top; y < top + TILE_SIZE; y++)
+    {
+        if(frameY[y] < 0)
+            continue;
+
+        const u16* source = frame + frameY[y]*width;
+        u16* target = this->image + y*SIZE;
+        for(u32 x = left; x < left + TILE_SIZE; x++)
+        {
+            s32 column = frameX[x];
+            if(column < 0)
+                continue;
+
+            // Each pair of YUV422 pixels shares its U and V
+            if(format == Platform::CAMERA_YUV422)
+            {
+                const u16* pair = source + (column & ~1);
+                target[x] = Yuv::toRgb565(source[column] & 0xFF, pair[0] >> 8, pair[1] >> 8);
+            }
+            else
+                target[x] = source[column];
+        }
+    }
+
+    this->dirty |= 1ull << tile;
+    this->seen |= 1ull << tile;
+}
+
+u32 Panorama::upload(u16* texture)
+{
+    constexpr u32 TEXTURE_TILES_PER_ROW = SIZE/Swizzle::TILE_SIZE;
+    u32 count = 0;
+    for(u32 tile = 0; tile < TILE_COUNT; tile++)
+    {
+        if(!(this->dirty >> tile & 1))
+            continue;
+
+        u32 left = (tile % TILES)*TILE_SIZE, top = (tile / TILES)*TILE_SIZE;
+        for(u32 y = top; y < top + TILE_SIZE; y += Swizzle::TILE_SIZE)
+            for(u32 x = left; x < left + TILE_SIZE; x += Swizzle::TILE_SIZE)
+                Swizzle::TileConverter<Swizzle::FORMAT_RGB565>::convert(this->image + y*SIZE + x, SIZE,
+                    texture + ((y/Swizzle::TILE_SIZE)*TEXTURE_TILES_PER_ROW + x/Swizzle::TILE_SIZE)*Swizzle::TILE_PIXELS);
+        count++;
+    }
+    this->dirty = 0;
+    return count;
+}
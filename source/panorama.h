@@ -0,0 +1,47 @@
+#pragma once
+
+#include "common.h"
+#include "camera.h"
+#include "fast_math.h"
+
+// Everything the camera has seen around the player, as a SIZE*SIZE RGB565 image over the game's tY (across) and tX (down) angles,
+// each wrapping at +-180 degrees like the splashes do
+// Frames are stitched in where the game would draw them for the view they were taken at, a TILE_SIZE square at a time:
+// only the tiles the frame covers are redrawn, they're marked dirty, and only dirty tiles go into the texture
+class Panorama
+{
+    public:
+        static constexpr u32 SIZE = 256;
+        static constexpr u32 TILE_SIZE = 32;
+        static constexpr u32 TILES = SIZE/TILE_SIZE; // per side
+        static constexpr u32 TILE_COUNT = TILES*TILES;
+        static constexpr float PIXEL_ANGLE = 360.0f/SIZE;
+        static_assert(TILE_COUNT <= 64, "tiles are tracked in a u64");
+
+        Panorama();
+
+        // Stitches the tiles a frame of the given packed size and format covers, seen at view angles tX and tY,
+        // going round the covered tiles from where the last call stopped, until budgetTicks have been spent
+        // At least one tile is done per call, returns how many were
+        u32 stitch(const u16* frame, u32 width, u32 height, Platform::CameraFormat format, float tX, float tY, u64 budgetTicks);
+        // Converts the dirty tiles into a SIZE wide tiled texture and marks them clean, returns how many there were
+        u32 upload(u16* texture);
+        void reset();
+
+        // Where angles land in the image, in pixels
+        static float column(float tY) { return (FastMath::wrapDegrees(tY) + 180.0f)/PIXEL_ANGLE; }
+        static float row(float tX) { return (FastMath::wrapDegrees(tX) + 180.0f)/PIXEL_ANGLE; }
+
+        const u16* pixels() const { return this->image; }
+        u64 dirtyTiles() const { return this->dirty; }
+        u64 seenTiles() const { return this->seen; }
+
+    private:
+        // Tiles a frame seen from tX and tY covers, a bit per tile
+        static u64 covered(float tX, float tY);
+        void stitchTile(u32 tile, const u16* frame, u32 width, Platform::CameraFormat format, const s16* frameX, const s16* frameY);
+
+        u16 image[SIZE*SIZE];
+        u64 dirty, seen;
+        u32 cursor; // the tile the next stitch starts looking from
+};
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "types.h"
+#include "triple_buffer.h"
+#include "memory.h"
+
+#ifdef _3DS
+#include <3ds.h>
+#else
+// Same bits as libctru's, so recordings made on the console replay on the host
+enum
+{
+    KEY_A       = 1u << 0,
+    KEY_B       = 1u << 1,
+    KEY_SELECT  = 1u << 2,
+    KEY_START   = 1u << 3,
+    KEY_DRIGHT  = 1u << 4,
+    KEY_DLEFT   = 1u << 5,
+    KEY_DUP     = 1u << 6,
+    KEY_DDOWN   = 1u << 7,
+    KEY_R       = 1u << 8,
+    KEY_L       = 1u << 9,
+    KEY_X       = 1u << 10,
+    KEY_Y       = 1u << 11,
+    KEY_ZL      = 1u << 14,
+    KEY_ZR      = 1u << 15,
+    KEY_TOUCH   = 1u << 20,
+    KEY_CSTICK_RIGHT = 1u << 24,
+    KEY_CSTICK_LEFT  = 1u << 25,
+    KEY_CSTICK_UP    = 1u << 26,
+    KEY_CSTICK_DOWN  = 1u << 27,
+    KEY_CPAD_RIGHT = 1u << 28,
+    KEY_CPAD_LEFT  = 1u << 29,
+    KEY_CPAD_UP    = 1u << 30,
+    KEY_CPAD_DOWN  = 1u << 31,
+
+    KEY_UP    = KEY_DUP    | KEY_CPAD_UP,
+    KEY_DOWN  = KEY_DDOWN  | KEY_CPAD_DOWN,
+    KEY_LEFT  = KEY_DLEFT  | KEY_CPAD_LEFT,
+    KEY_RIGHT = KEY_DRIGHT | KEY_CPAD_RIGHT,
+};
+#endif
+
+// Everything the game needs from the system, implemented by platform_3ds.cpp on the console and by host/platform_host.cpp on a workstation
+namespace Platform
+{
+    // Same layout as C2D_Color32
+    constexpr u32 color32(u8 r, u8 g, u8 b, u8 a)
+    {
+        return r | (g << 8) | (b << 16) | ((u32)a << 24);
+    }
+
+    // Brings up the system and the GPU, the rest comes up with the calls after it, except the camera which has its own thread
+    // Those only need init, and can run on other threads at the same time as each other
+    void init();
+    void initSensors();
+    void loadSprites();
+    void initYuvConversion();
+    void exit();
+    bool mainLoop();
+
+    // Where recordings are read from and written to
+    extern const char* const DATA_DIRECTORY;
+
+    typedef struct
+    {
+        u32 keysDown, keysHeld;
+        s16 accel[3]; // x, y, z
+        s16 gyro[3]; // x, z, y, the order hidGyroRead uses
+    } Input;
+
+    void readInput(Input* input);
+
+    // The console's system tick, the host converts its own clock to the same rate
+    constexpr u64 TICKS_PER_SECOND = 268111856;
+    u64 ticks();
+    void sleep(u64 nanoseconds);
+
+    typedef struct ThreadData* Thread;
+    Thread createThread(void (*entry)(void*), void* arg, size_t stackSize, int priority, int core);
+    void joinThread(Thread thread);
+
+    // Cores threads can be put on, numbered from 0, the main thread being on 0
+    u32 coreCount();
+
+    // Memory the system's DMA can write into and read from, like camera frames, counted against tag
+    void* allocateLinear(size_t size, Memory::Tag tag);
+    void freeLinear(void* pointer, size_t size, Memory::Tag tag);
+
+    class Mutex
+    {
+        public:
+            Mutex();
+            ~Mutex();
+
+            void lock();
+            void unlock();
+
+        private:
+            void* handle;
+    };
+
+    class Semaphore
+    {
+        public:
+            Semaphore();
+            ~Semaphore();
+
+            void acquire();
+            void release(u32 count = 1);
+
+        private:
+            void* handle;
+    };
+
+    // YUV422 pixels keep Y in their low byte, and U for even pixels or V for odd ones in their high byte
+    typedef enum
+    {
+        CAMERA_RGB565,
+        CAMERA_YUV422,
+    } CameraFormat;
+
+    // The outer cameras give 400x240, 320x240 or 160x120 pictures, at 30, 15 or 10 frames per second
+    typedef struct
+    {
+        u16 width, height;
+        u8 frameRate;
+        u8 cameras; // 2 for both outer cameras in step
+        u8 format;
+    } CameraMode;
+
+    // Publishes frames in the mode's format until stop is set, meant to run on its own thread
+    // Frames are packed, their rows width pixels apart, so smaller pictures only fill the start of the CAMERA_BUFFER_SIZE
+    // With two cameras each published buffer holds the left eye's frame then the right one's, CAMERA_BUFFER_SIZE apart
+    // process is given every frame on that thread once it's published, it's only reused after process returns
+    void captureCamera(TripleBuffer<u16>* frames, const CameraMode& mode, volatile bool* stop, void (*process)(const u16* frame, void* data), void* data);
+
+    typedef enum
+    {
+        SCREEN_TOP,
+        SCREEN_BOTTOM,
+        SCREEN_TOP_RIGHT, // the top screen's right eye picture, only shown in 3D
+    } Screen;
+
+    // Whether the top screen shows SCREEN_TOP_RIGHT to the right eye, and how far up the 3D slider is, from 0 to 1
+    void setStereo(bool enabled);
+    float stereoSlider();
+
+    void beginFrame();
+    void beginScreen(Screen screen, u32 clearColor);
+    void endFrame();
+
+    // Tiled textures the CPU writes into, counted against Memory::TAG_TEXTURES
+    // setTextureArea limits drawing to the top left width by height pixels, the whole texture is drawn otherwise
+    // RGBA8 texels are kept as the GPU reads them, red in the top byte and alpha in the bottom one
+    typedef enum
+    {
+        TEXTURE_RGB565,
+        TEXTURE_RGBA8,
+    } TextureFormat;
+
+    typedef struct TextureData* Texture;
+    Texture createTexture(u16 width, u16 height, TextureFormat format = TEXTURE_RGB565);
+    void deleteTexture(Texture texture);
+    void setTextureArea(Texture texture, u16 width, u16 height);
+    void* textureData(Texture texture);
+    void flushTexture(Texture texture);
+    void drawTexture(Texture texture, float x, float y, float depth, float scaleX = 1.0f, float scaleY = 1.0f);
+    // Draws width by height texels from (u, v), going round the texture's edges, stretched over screenWidth by screenHeight
+    void drawTextureWrapped(Texture texture, float u, float v, float width, float height, float x, float y, float depth, float screenWidth, float screenHeight);
+
+    // Converts a YUV422 frame straight into the top left of a texture with the Y2R unit, without the CPU touching a pixel
+    // Returns false when there is no unit to do it or it failed, the texture's contents are then unknown
+    bool hasYuvConversion();
+    bool convertYuvToTexture(const u16* frame, u16 width, u16 height, Texture texture);
+
+    // Images are indices into the sprite sheet, sprites.h has their names
+    void drawImage(u32 image, float x, float y, float depth, float scale = 1.0f);
+    void drawImageTinted(u32 image, float x, float y, float depth, u32 color, float scale = 1.0f);
+    void drawRect(float x, float y, float depth, float width, float height, u32 color);
+
+    // Quads kept from one frame to the next, for things like the HUD that barely change
+    // They are drawn sorted by texture then depth, and only sorted again after a change
+    constexpr u32 NO_IMAGE = UINT32_MAX; // a solid rectangle of the quad's color
+
+    typedef struct
+    {
+        u32 image;
+        float x, y, depth;
+        float width, height; // rectangles only, images are sized by scale
+        float scale;
+        u32 color;
+        bool tinted;
+    } Quad;
+
+    inline bool sameQuad(const Quad& a, const Quad& b)
+    {
+        return a.image == b.image && a.x == b.x && a.y == b.y && a.depth == b.depth && a.width == b.width && a.height == b.height
+            && a.scale == b.scale && a.color == b.color && a.tinted == b.tinted;
+    }
+
+    typedef struct
+    {
+        u32 vertices, drawCalls;
+    } DrawStats;
+
+    // setQuads replaces every quad at once, for lists rebuilt each frame but drawn more than once
+    // offsetX moves the whole list sideways when drawing it, like for one eye in 3D
+    typedef struct DrawListData* DrawList;
+    DrawList createDrawList(const Quad* quads, u32 count);
+    void deleteDrawList(DrawList list);
+    void setQuad(DrawList list, u32 index, const Quad& quad);
+    void setQuads(DrawList list, const Quad* quads, u32 count);
+    DrawStats drawDrawList(DrawList list, float offsetX = 0.0f);
+
+    // Static text is parsed once, the string overload only lasts until the end of the frame
+    // Text created with a capacity has its own glyph buffer, and setText only parses it again when the string changed
+    // There can be MAX_TEXTS at once, counted against Memory::TAG_TEXT with their buffers
+    constexpr u32 MAX_TEXTS = 32;
+    typedef struct TextData* Text;
+    Text createText(const char* string);
+    Text createText(size_t capacity);
+    bool setText(Text text, const char* string);
+    float textWidth(Text text, float scale);
+    void deleteText(Text text);
+    void drawText(Text text, float x, float y, float depth, float scale, u32 color);
+    void drawText(const char* string, float x, float y, float depth, float scale, u32 color);
+}
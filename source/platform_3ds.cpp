@@ -0,0 +1,670 @@
+#include "common.h"
+#include "camera.h"
+#include "capture_ring.h"
+#include "object_pool.h"
+#include <citro3d.h>
+#include <citro2d.h>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <malloc.h>
+
+namespace Platform
+{
+    const char* const DATA_DIRECTORY = "sdmc:/3ds/PaintAR";
+
+    static u32 old_time_limit;
+    static C3D_RenderTarget *top, *topRight, *bottom;
+    static C2D_SpriteSheet spritesheet;
+    static C2D_TextBuf staticBuf, dynamicBuf;
+    static bool y2rReady;
+    static Handle y2rDone;
+    static size_t renderTargetBytes, graphicsBytes, spriteBytes, textBufferBytes; // what init and loadSprites counted
+
+    struct TextureData
+    {
+        C3D_Tex tex;
+        Tex3DS_SubTexture subtex;
+        C2D_Image image;
+    };
+
+    struct DrawListData
+    {
+        std::vector<Quad> quads;
+        std::vector<C2D_Image> images;
+        std::vector<C2D_DrawParams> params;
+        std::vector<C2D_ImageTint> tints;
+        std::vector<u32> order;
+        u32 drawCalls;
+        bool sorted;
+    };
+
+    struct TextData
+    {
+        C2D_Text text;
+        C2D_TextBuf buf; // NULL for static text, which lives in staticBuf
+        std::vector<char> string;
+        size_t bytes; // buf and string, on the heap
+    };
+
+    static ObjectPool<TextData, MAX_TEXTS> texts(Memory::TAG_TEXT);
+    static constexpr size_t GLYPH_BYTES = 36; // about what a text buffer keeps per glyph
+
+    // The libraries allocate on their own, so what they take is measured around their calls
+    static size_t heapUsed()
+    {
+        return mallinfo().uordblks;
+    }
+
+    void init()
+    {
+        consoleDebugInit(debugDevice_SVC);
+
+        APT_GetAppCpuTimeLimit(&old_time_limit);
+        APT_SetAppCpuTimeLimit(30);
+
+        romfsInit();
+
+        u32 linearBefore = linearSpaceFree();
+        gfxInitDefault();
+        C3D_Init(C3D_DEFAULT_CMDBUF_SIZE);
+        C2D_Init(C2D_DEFAULT_MAX_OBJECTS);
+        C2D_Prepare();
+
+        u32 vramBefore = vramSpaceFree();
+        top = C2D_CreateScreenTarget(GFX_TOP, GFX_LEFT);
+        topRight = C2D_CreateScreenTarget(GFX_TOP, GFX_RIGHT);
+        bottom = C2D_CreateScreenTarget(GFX_BOTTOM, GFX_LEFT);
+        renderTargetBytes = vramBefore - vramSpaceFree();
+        Memory::account(Memory::TAG_RENDER_TARGETS, renderTargetBytes);
+
+        graphicsBytes = linearBefore - linearSpaceFree();
+        Memory::account(Memory::TAG_GRAPHICS, graphicsBytes);
+
+        size_t heapBefore = heapUsed();
+        staticBuf = C2D_TextBufNew(512);
+        dynamicBuf = C2D_TextBufNew(512);
+        textBufferBytes = heapUsed() - heapBefore;
+        Memory::account(Memory::TAG_TEXT, textBufferBytes);
+    }
+
+    void initSensors()
+    {
+        DEBUG("%.8lx\n", HIDUSER_EnableAccelerometer());
+        DEBUG("%.8lx\n", HIDUSER_EnableGyroscope());
+    }
+
+    // Other threads allocate from the linear heap meanwhile, so the sheet is counted by its texture rather than measured
+    // sprites/sprites.t3s keeps the atlas RGBA8888, only compressed on the romfs: the 12x22 digits and the 20x40 beams would smear
+    // in ETC1's 4x4 blocks, and 4 bit alpha would band the gun's and the tinted paint's soft edges
+    void loadSprites()
+    {
+        spritesheet = C2D_SpriteSheetLoad("romfs:/gfx/sprites.t3x");
+        spriteBytes = spritesheet ? C2D_SpriteSheetGetImage(spritesheet, 0).tex->size : 0;
+        Memory::account(Memory::TAG_GRAPHICS, spriteBytes);
+    }
+
+    void initYuvConversion()
+    {
+        // The end event only fires with the interrupt turned on
+        y2rReady = R_SUCCEEDED(y2rInit()) && R_SUCCEEDED(Y2RU_SetTransferEndInterrupt(true)) && R_SUCCEEDED(Y2RU_GetTransferEndEvent(&y2rDone));
+        DEBUG("y2r %s\n", y2rReady ? "ready" : "unavailable");
+    }
+
+    void exit()
+    {
+        if(y2rReady)
+            y2rExit();
+
+        C2D_TextBufDelete(dynamicBuf);
+        C2D_TextBufDelete(staticBuf);
+        C2D_SpriteSheetFree(spritesheet);
+        Memory::release(Memory::TAG_TEXT, textBufferBytes);
+        Memory::release(Memory::TAG_GRAPHICS, graphicsBytes + spriteBytes);
+        Memory::release(Memory::TAG_RENDER_TARGETS, renderTargetBytes);
+
+        C2D_Fini();
+        C3D_Fini();
+        gfxExit();
+
+        DEBUG("%.8lx\n", HIDUSER_DisableGyroscope());
+        DEBUG("%.8lx\n", HIDUSER_DisableAccelerometer());
+        romfsExit();
+
+        if(old_time_limit != UINT32_MAX)
+        {
+            APT_SetAppCpuTimeLimit(old_time_limit);
+        }
+    }
+
+    bool mainLoop()
+    {
+        return aptMainLoop();
+    }
+
+    void readInput(Input* input)
+    {
+        hidScanInput();
+        input->keysDown = hidKeysDown();
+        input->keysHeld = hidKeysHeld();
+
+        accelVector vector;
+        angularRate rate;
+        hidAccelRead(&vector);
+        hidGyroRead(&rate);
+        input->accel[0] = vector.x;
+        input->accel[1] = vector.y;
+        input->accel[2] = vector.z;
+        input->gyro[0] = rate.x;
+        input->gyro[1] = rate.z;
+        input->gyro[2] = rate.y;
+    }
+
+    u64 ticks()
+    {
+        return svcGetSystemTick();
+    }
+
+    void sleep(u64 nanoseconds)
+    {
+        svcSleepThread(nanoseconds);
+    }
+
+    Thread createThread(void (*entry)(void*), void* arg, size_t stackSize, int priority, int core)
+    {
+        return (Thread)threadCreate(entry, arg, stackSize, priority, core, false);
+    }
+
+    void joinThread(Thread thread)
+    {
+        threadJoin((::Thread)thread, U64_MAX);
+        threadFree((::Thread)thread);
+    }
+
+    // The syscore is shared with the system, which the time limit set in init makes room for, and the New 3DS adds a third core
+    u32 coreCount()
+    {
+        bool isNew3DS = false;
+        APT_CheckNew3DS(&isNew3DS);
+        return isNew3DS ? 3 : 2;
+    }
+
+    void* allocateLinear(size_t size, Memory::Tag tag)
+    {
+        void* pointer = linearAlloc(size);
+        if(pointer != NULL)
+            Memory::account(tag, size);
+        return pointer;
+    }
+
+    void freeLinear(void* pointer, size_t size, Memory::Tag tag)
+    {
+        if(pointer == NULL)
+            return;
+        linearFree(pointer);
+        Memory::release(tag, size);
+    }
+
+    Mutex::Mutex()
+    {
+        LightLock* lock = new LightLock;
+        LightLock_Init(lock);
+        this->handle = lock;
+    }
+
+    Mutex::~Mutex()
+    {
+        delete (LightLock*)this->handle;
+    }
+
+    void Mutex::lock()
+    {
+        LightLock_Lock((LightLock*)this->handle);
+    }
+
+    void Mutex::unlock()
+    {
+        LightLock_Unlock((LightLock*)this->handle);
+    }
+
+    Semaphore::Semaphore()
+    {
+        LightSemaphore* semaphore = new LightSemaphore;
+        LightSemaphore_Init(semaphore, 0, INT16_MAX);
+        this->handle = semaphore;
+    }
+
+    Semaphore::~Semaphore()
+    {
+        delete (LightSemaphore*)this->handle;
+    }
+
+    void Semaphore::acquire()
+    {
+        LightSemaphore_Acquire((LightSemaphore*)this->handle, 1);
+    }
+
+    void Semaphore::release(u32 count)
+    {
+        LightSemaphore_Release((LightSemaphore*)this->handle, count);
+    }
+
+    // Both outer cameras go through their own port, PORT_CAM1 for the left eye and PORT_CAM2 for the right one
+    // Pictures are received straight into the frames, nothing is copied on the way
+    void captureCamera(TripleBuffer<u16>* frames, const CameraMode& mode, volatile bool* stop, void (*process)(const u16* frame, void* data), void* data)
+    {
+        Handle events[4] = {0}; // a frame received on each camera, then a buffer error on each
+        u32 transferUnit;
+        u32 cameras = mode.cameras;
+        u32 select = cameras == 2 ? SELECT_OUT1_OUT2 : SELECT_OUT1;
+        u32 ports = cameras == 2 ? PORT_BOTH : PORT_CAM1;
+        CAMU_Size size = mode.width == 160 ? SIZE_QQVGA : mode.width == 320 ? SIZE_QVGA : SIZE_CTR_TOP_LCD;
+        CAMU_FrameRate frameRate = mode.frameRate == 10 ? FRAME_RATE_10 : mode.frameRate == 15 ? FRAME_RATE_15 : FRAME_RATE_30;
+
+        CaptureRing ring(frames, cameras, CAMERA_BUFFER_SIZE);
+        u32 pictureBytes = mode.width*mode.height*sizeof(u16);
+        auto receive = [&](u32 camera) {
+            CAMU_SetReceiving(&events[camera], ring.target(camera), PORT_CAM1 << camera, pictureBytes, (s16) transferUnit);
+        };
+
+        camInit();
+        CAMU_SetSize(select, size, CONTEXT_A);
+        CAMU_SetOutputFormat(select, mode.format == CAMERA_YUV422 ? OUTPUT_YUV_422 : OUTPUT_RGB_565, CONTEXT_A);
+        CAMU_SetFrameRate(select, frameRate);
+        CAMU_SetNoiseFilter(select, true);
+        CAMU_SetAutoExposure(select, true);
+        CAMU_SetAutoWhiteBalance(select, true);
+        CAMU_Activate(select);
+        if(cameras == 2)
+            CAMU_SynchronizeVsyncTiming(SELECT_OUT1, SELECT_OUT2);
+        for(u32 camera = 0; camera < cameras; camera++)
+            CAMU_GetBufferErrorInterruptEvent(&events[cameras + camera], PORT_CAM1 << camera);
+        CAMU_SetTrimming(ports, false);
+        CAMU_GetMaxBytes(&transferUnit, mode.width, mode.height);
+        CAMU_SetTransferBytes(ports, transferUnit, mode.width, mode.height);
+        CAMU_ClearBuffer(ports);
+        for(u32 camera = 0; camera < cameras; camera++)
+            receive(camera);
+        CAMU_StartCapture(ports);
+
+        // A camera that delivered waits for the others, as its next picture has to go in the next slot
+        // Only the live handles are waited on, a camera that delivered has none until the pair is complete
+        while(!*stop)
+        {
+            Handle waiting[4];
+            u32 slots[4], count = 0;
+            for(u32 i = 0; i < cameras*2; i++)
+            {
+                if(events[i] != 0)
+                {
+                    waiting[count] = events[i];
+                    slots[count++] = i;
+                }
+            }
+
+            s32 fired = -1;
+            if(R_FAILED(svcWaitSynchronizationN(&fired, waiting, count, false, U64_MAX)) || fired < 0 || (u32)fired >= count)
+                continue;
+
+            u32 index = slots[fired];
+            if(index < cameras)
+            {
+                svcCloseHandle(events[index]);
+                events[index] = 0;
+                // The CPU mustn't read what it cached of the slot before the transfer
+                GSPGPU_InvalidateDataCache(ring.target(index), pictureBytes);
+                const u16* frame = ring.received(index);
+                if(frame != NULL)
+                {
+                    for(u32 camera = 0; camera < cameras; camera++)
+                        receive(camera);
+                    process(frame, data);
+                }
+            }
+            else
+            {
+                // Start every camera over so they stay in step, into the same slot, dropping the half received pair
+                for(u32 camera = 0; camera < cameras; camera++)
+                {
+                    if(events[camera] != 0)
+                    {
+                        svcCloseHandle(events[camera]);
+                        events[camera] = 0;
+                    }
+                }
+                ring.dropped();
+                CAMU_ClearBuffer(ports);
+                if(cameras == 2)
+                    CAMU_SynchronizeVsyncTiming(SELECT_OUT1, SELECT_OUT2);
+                for(u32 camera = 0; camera < cameras; camera++)
+                    receive(camera);
+                CAMU_StartCapture(ports);
+            }
+        }
+
+        CAMU_StopCapture(ports);
+
+        bool busy = false;
+        for(u32 camera = 0; camera < cameras; camera++)
+        {
+            while(R_SUCCEEDED(CAMU_IsBusy(&busy, PORT_CAM1 << camera)) && busy)
+            {
+                svcSleepThread(1e6);
+            }
+        }
+
+        CAMU_ClearBuffer(ports);
+        CAMU_Activate(SELECT_NONE);
+        camExit();
+
+        for(int i = 0; i < 4; i++)
+        {
+            if(events[i] != 0)
+            {
+                svcCloseHandle(events[i]);
+                events[i] = 0;
+            }
+        }
+    }
+
+    void beginFrame()
+    {
+        C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
+        C2D_TextBufClear(dynamicBuf);
+    }
+
+    void beginScreen(Screen screen, u32 clearColor)
+    {
+        C3D_RenderTarget* target = screen == SCREEN_TOP ? top : screen == SCREEN_TOP_RIGHT ? topRight : bottom;
+        C2D_SceneBegin(target);
+        C2D_TargetClear(target, clearColor);
+    }
+
+    void setStereo(bool enabled)
+    {
+        gfxSet3D(enabled);
+    }
+
+    float stereoSlider()
+    {
+        return osGet3DSliderState();
+    }
+
+    void endFrame()
+    {
+        C3D_FrameEnd(0);
+    }
+
+    Texture createTexture(u16 width, u16 height, TextureFormat format)
+    {
+        Texture texture = new TextureData;
+        texture->subtex = { width, height, 0.0f, 1.0f, 1.0f, 0.0f };
+        texture->image = { &texture->tex, &texture->subtex };
+        C3D_TexInit(&texture->tex, width, height, format == TEXTURE_RGBA8 ? GPU_RGBA8 : GPU_RGB565);
+        C3D_TexSetFilter(&texture->tex, GPU_LINEAR, GPU_LINEAR);
+        Memory::account(Memory::TAG_TEXTURES, texture->tex.size);
+        return texture;
+    }
+
+    void deleteTexture(Texture texture)
+    {
+        Memory::release(Memory::TAG_TEXTURES, texture->tex.size);
+        C3D_TexDelete(&texture->tex);
+        delete texture;
+    }
+
+    // The subtexture's top is at v = 1, as textures are stored upside down
+    void setTextureArea(Texture texture, u16 width, u16 height)
+    {
+        texture->subtex = { width, height, 0.0f, 1.0f, (float)width/texture->tex.width, 1.0f - (float)height/texture->tex.height };
+    }
+
+    void* textureData(Texture texture)
+    {
+        return texture->tex.data;
+    }
+
+    void flushTexture(Texture texture)
+    {
+        C3D_TexFlush(&texture->tex);
+    }
+
+    void drawTexture(Texture texture, float x, float y, float depth, float scaleX, float scaleY)
+    {
+        C2D_DrawImageAt(texture->image, x, y, depth, NULL, scaleX, scaleY);
+    }
+
+    // Texture coordinates past the edges come back round with GPU_REPEAT, the area is only used for this draw
+    void drawTextureWrapped(Texture texture, float u, float v, float width, float height, float x, float y, float depth, float screenWidth, float screenHeight)
+    {
+        float texWidth = texture->tex.width, texHeight = texture->tex.height;
+        Tex3DS_SubTexture subtex = { (u16)width, (u16)height, u/texWidth, 1.0f - v/texHeight, (u + width)/texWidth, 1.0f - (v + height)/texHeight };
+        C3D_TexSetWrap(&texture->tex, GPU_REPEAT, GPU_REPEAT);
+        C2D_Image image = {&texture->tex, &subtex};
+        C2D_DrawImageAt(image, x, y, depth, NULL, screenWidth/subtex.width, screenHeight/subtex.height);
+    }
+
+    bool hasYuvConversion()
+    {
+        return y2rReady;
+    }
+
+    // There is a single unit, so only one conversion can run at a time
+    // Its 8x8 blocks come out in the GPU's tile order, a row of tiles at a time, the gaps skipping the rest of each texture row
+    static constexpr s64 Y2R_TIMEOUT_NANOSECONDS = 1000000000/30;
+
+    bool convertYuvToTexture(const u16* frame, u16 width, u16 height, Texture texture)
+    {
+        if(!y2rReady)
+            return false;
+
+        Y2RU_ConversionParams params;
+        params.input_format = INPUT_YUV422_BATCH;
+        params.output_format = OUTPUT_RGB_16_565;
+        params.rotation = ROTATION_NONE;
+        params.block_alignment = BLOCK_8_BY_8;
+        params.input_line_width = width;
+        params.input_lines = height;
+        params.standard_coefficient = COEFFICIENT_ITU_R_BT_601;
+        params.unused = 0;
+        params.alpha = 0xFF;
+        if(R_FAILED(Y2RU_SetConversionParams(&params)))
+            return false;
+
+        // The camera wrote the frame without going through the cache, but the texture mustn't have lines left in it to overwrite the result with
+        u32 pictureBytes = width*height*sizeof(u16);
+        GSPGPU_FlushDataCache(texture->tex.data, texture->tex.size);
+        Y2RU_SetSendingYUYV(frame, pictureBytes, width*sizeof(u16), 0);
+        Y2RU_SetReceiving(texture->tex.data, pictureBytes, width*8*sizeof(u16), (texture->tex.width - width)*8*sizeof(u16));
+        if(R_FAILED(Y2RU_StartConversion()))
+            return false;
+
+        // A whole picture takes a few milliseconds, a frame going by means the unit is stuck
+        // Timing out isn't an R_FAILED result, so anything but success counts
+        if(svcWaitSynchronization(y2rDone, Y2R_TIMEOUT_NANOSECONDS) != 0)
+        {
+            Y2RU_StopConversion();
+            return false;
+        }
+        return true;
+    }
+
+    void drawImage(u32 image, float x, float y, float depth, float scale)
+    {
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, image), x, y, depth, NULL, scale, scale);
+    }
+
+    void drawImageTinted(u32 image, float x, float y, float depth, u32 color, float scale)
+    {
+        C2D_ImageTint tint;
+        C2D_PlainImageTint(&tint, color, 1.0f);
+        C2D_DrawImageAt(C2D_SpriteSheetGetImage(spritesheet, image), x, y, depth, &tint, scale, scale);
+    }
+
+    void drawRect(float x, float y, float depth, float width, float height, u32 color)
+    {
+        C2D_DrawRectSolid(x, y, depth, width, height, color);
+    }
+
+    // Does the sprite sheet lookup and the size calculation C2D_DrawImageAt would otherwise do every frame
+    static void prepareQuad(DrawList list, u32 index)
+    {
+        const Quad& quad = list->quads[index];
+        float width = quad.width, height = quad.height;
+        if(quad.image != NO_IMAGE)
+        {
+            list->images[index] = C2D_SpriteSheetGetImage(spritesheet, quad.image);
+            width = quad.scale*list->images[index].subtex->width;
+            height = quad.scale*list->images[index].subtex->height;
+            if(quad.tinted)
+                C2D_PlainImageTint(&list->tints[index], quad.color, 1.0f);
+        }
+        list->params[index] = { { quad.x, quad.y, width, height }, { 0.0f, 0.0f }, quad.depth, 0.0f };
+    }
+
+    // Solid rectangles don't bind a texture, so only switching between textures splits a draw call
+    static void sortDrawList(DrawList list)
+    {
+        auto texture = [list](u32 index) { return list->quads[index].image == NO_IMAGE ? NULL : list->images[index].tex; };
+        std::stable_sort(list->order.begin(), list->order.end(), [list, texture](u32 a, u32 b) {
+            if(texture(a) != texture(b))
+                return texture(a) < texture(b);
+            return list->quads[a].depth < list->quads[b].depth;
+        });
+
+        C3D_Tex* bound = NULL;
+        list->drawCalls = 0;
+        for(auto index : list->order)
+        {
+            C3D_Tex* tex = texture(index);
+            if(tex != NULL && tex != bound)
+            {
+                bound = tex;
+                list->drawCalls++;
+            }
+        }
+        if(list->drawCalls == 0 && !list->order.empty())
+            list->drawCalls = 1;
+        list->sorted = true;
+    }
+
+    DrawList createDrawList(const Quad* quads, u32 count)
+    {
+        DrawList list = new DrawListData;
+        setQuads(list, quads, count);
+        return list;
+    }
+
+    void deleteDrawList(DrawList list)
+    {
+        delete list;
+    }
+
+    void setQuad(DrawList list, u32 index, const Quad& quad)
+    {
+        if(sameQuad(list->quads[index], quad))
+            return;
+
+        Quad& old = list->quads[index];
+        if(old.image != quad.image || old.depth != quad.depth)
+            list->sorted = false;
+        old = quad;
+        prepareQuad(list, index);
+    }
+
+    void setQuads(DrawList list, const Quad* quads, u32 count)
+    {
+        list->quads.assign(quads, quads + count);
+        list->images.resize(count);
+        list->params.resize(count);
+        list->tints.resize(count);
+        list->order.resize(count);
+        for(u32 i = 0; i < count; i++)
+        {
+            list->order[i] = i;
+            prepareQuad(list, i);
+        }
+        list->sorted = false;
+    }
+
+    DrawStats drawDrawList(DrawList list, float offsetX)
+    {
+        if(!list->sorted)
+            sortDrawList(list);
+
+        for(auto index : list->order)
+        {
+            const Quad& quad = list->quads[index];
+            C2D_DrawParams params = list->params[index];
+            params.pos.x += offsetX;
+            if(quad.image == NO_IMAGE)
+                C2D_DrawRectSolid(params.pos.x, params.pos.y, params.depth, params.pos.w, params.pos.h, quad.color);
+            else
+                C2D_DrawImage(list->images[index], &params, quad.tinted ? &list->tints[index] : NULL);
+        }
+        return { (u32)list->order.size()*6, list->drawCalls };
+    }
+
+    Text createText(const char* string)
+    {
+        Text text = texts.create();
+        text->buf = NULL;
+        text->bytes = 0;
+        C2D_TextParse(&text->text, staticBuf, string);
+        C2D_TextOptimize(&text->text);
+        return text;
+    }
+
+    // Texts are made while other threads allocate at startup, so their buffers are counted by size rather than measured
+    Text createText(size_t capacity)
+    {
+        Text text = texts.create();
+        text->buf = C2D_TextBufNew(capacity);
+        text->string.assign(capacity+1, '\0');
+        text->bytes = capacity*GLYPH_BYTES + text->string.capacity();
+        Memory::account(Memory::TAG_TEXT, text->bytes);
+        C2D_TextParse(&text->text, text->buf, "");
+        return text;
+    }
+
+    bool setText(Text text, const char* string)
+    {
+        size_t capacity = text->string.size()-1;
+        if(!strncmp(text->string.data(), string, capacity))
+            return false;
+
+        strncpy(text->string.data(), string, capacity);
+        C2D_TextBufClear(text->buf);
+        C2D_TextParse(&text->text, text->buf, text->string.data());
+        C2D_TextOptimize(&text->text);
+        return true;
+    }
+
+    float textWidth(Text text, float scale)
+    {
+        float width = 0.0f;
+        C2D_TextGetDimensions(&text->text, scale, scale, &width, NULL);
+        return width;
+    }
+
+    void deleteText(Text text)
+    {
+        if(text->buf)
+            C2D_TextBufDelete(text->buf);
+        Memory::release(Memory::TAG_TEXT, text->bytes);
+        texts.destroy(text);
+    }
+
+    void drawText(Text text, float x, float y, float depth, float scale, u32 color)
+    {
+        C2D_DrawText(&text->text, C2D_WithColor, x, y, depth, scale, scale, color);
+    }
+
+    void drawText(const char* string, float x, float y, float depth, float scale, u32 color)
+    {
+        C2D_Text text;
+        C2D_TextParse(&text, dynamicBuf, string);
+        C2D_TextOptimize(&text);
+        C2D_DrawText(&text, C2D_WithColor, x, y, depth, scale, scale, color);
+    }
+}
@@ -0,0 +1,110 @@
+#include "profiler.h"
+
+#ifdef PROFILER
+
+#include <algorithm>
+#include <cstdio>
+
+namespace Profiler
+{
+    static const char* const zoneNames[ZONE_AMOUNT] = {
+        "update",
+        "draw",
+        "frame begin",
+        "frame jobs",
+        "camera image",
+        "paint splashes",
+        "overlay",
+        "text",
+    };
+
+    static u32 samples[ZONE_AMOUNT][SAMPLE_COUNT];
+    static u32 counters[COUNTER_AMOUNT];
+    static u32 sampleCounts[ZONE_AMOUNT];
+
+    static constexpr float TICKS_PER_MILLISECOND = Platform::TICKS_PER_SECOND/1000.0f;
+
+    void record(Zone zone, u32 ticks)
+    {
+        samples[zone][sampleCounts[zone] & (SAMPLE_COUNT-1)] = ticks;
+        sampleCounts[zone]++;
+    }
+
+    Stats stats(Zone zone)
+    {
+        Stats stats = {0, 0, 0};
+        u32 count = std::min(sampleCounts[zone], SAMPLE_COUNT);
+        if(count == 0)
+            return stats;
+
+        u32 sorted[SAMPLE_COUNT];
+        std::copy(samples[zone], samples[zone] + count, sorted);
+
+        u64 total = 0;
+        for(u32 i = 0; i < count; i++)
+            total += sorted[i];
+
+        u32 p99 = count*99/100;
+        std::nth_element(sorted, sorted + p99, sorted + count);
+        stats.min = *std::min_element(sorted, sorted + count);
+        stats.average = total/count;
+        stats.p99 = sorted[p99];
+        return stats;
+    }
+
+    void count(Counter counter, u32 value)
+    {
+        counters[counter] = value;
+    }
+
+    void histogram(Zone zone, u32 bucketTicks, u32* buckets, u32 bucketCount)
+    {
+        std::fill(buckets, buckets + bucketCount, 0);
+        u32 count = std::min(sampleCounts[zone], SAMPLE_COUNT);
+        for(u32 i = 0; i < count; i++)
+            buckets[std::min(samples[zone][i]/bucketTicks, bucketCount-1)]++;
+    }
+
+    void drawOverlay(float x, float y, float depth, u32 color)
+    {
+        constexpr float TEXT_SCALE = 0.4f;
+        constexpr float LINE_HEIGHT = 10.0f;
+        constexpr float NUMBERS_X = 80.0f;
+
+        char buffer[64];
+        Platform::drawText("zone", x, y, depth, TEXT_SCALE, color);
+        Platform::drawText("min / avg / p99 (ms)", x + NUMBERS_X, y, depth, TEXT_SCALE, color);
+        for(u32 zone = 0; zone < ZONE_AMOUNT; zone++)
+        {
+            Stats zoneStats = stats((Zone)zone);
+            sprintf(buffer, "%.2f / %.2f / %.2f", zoneStats.min/TICKS_PER_MILLISECOND, zoneStats.average/TICKS_PER_MILLISECOND, zoneStats.p99/TICKS_PER_MILLISECOND);
+            float lineY = y + LINE_HEIGHT*(zone+1);
+            Platform::drawText(zoneNames[zone], x, lineY, depth, TEXT_SCALE, color);
+            Platform::drawText(buffer, x + NUMBERS_X, lineY, depth, TEXT_SCALE, color);
+        }
+
+        sprintf(buffer, "HUD: %lu vertices in %lu draw calls", (unsigned long)counters[COUNTER_HUD_VERTICES], (unsigned long)counters[COUNTER_HUD_DRAW_CALLS]);
+        Platform::drawText(buffer, x, y + LINE_HEIGHT*(ZONE_AMOUNT+1), depth, TEXT_SCALE, color);
+
+        // Update times in 2ms buckets up to 50ms, with a marker at the 60fps budget
+        constexpr u32 BUCKET_COUNT = 25;
+        constexpr float BUCKET_WIDTH = 12.0f;
+        constexpr float BAR_HEIGHT = 30.0f;
+        constexpr u32 BUCKET_TICKS = Platform::TICKS_PER_SECOND/500;
+        constexpr u32 budgetColor = Platform::color32(0xFF, 0x40, 0x40, 0xFF);
+
+        u32 buckets[BUCKET_COUNT];
+        histogram(ZONE_UPDATE, BUCKET_TICKS, buckets, BUCKET_COUNT);
+        u32 highest = std::max(*std::max_element(buckets, buckets + BUCKET_COUNT), 1u);
+
+        float bottom = y + LINE_HEIGHT*(ZONE_AMOUNT+2) + 4 + BAR_HEIGHT;
+        for(u32 i = 0; i < BUCKET_COUNT; i++)
+        {
+            float height = BAR_HEIGHT*buckets[i]/highest;
+            Platform::drawRect(x + BUCKET_WIDTH*i, bottom - height, depth, BUCKET_WIDTH - 2, height, color);
+        }
+        Platform::drawRect(x + BUCKET_WIDTH*(1000.0f/60/2), bottom - BAR_HEIGHT, depth, 1, BAR_HEIGHT, budgetColor);
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "types.h"
+#include "platform.h"
+
+// Scoped timing zones, kept as a ring of the last SAMPLE_COUNT durations per zone
+// Only compiled in when PROFILER is defined, otherwise PROFILE_ZONE expands to nothing
+namespace Profiler
+{
+    typedef enum
+    {
+        ZONE_UPDATE,
+        ZONE_DRAW,
+        ZONE_FRAME_BEGIN, // waiting on the GPU for the previous frame
+        ZONE_FRAME_JOBS,
+        ZONE_CAMERA_IMAGE,
+        ZONE_PAINT_SPLASHES,
+        ZONE_OVERLAY,
+        ZONE_TEXT,
+
+        ZONE_AMOUNT
+    } Zone;
+
+    // Plain per-frame numbers shown next to the timings
+    typedef enum
+    {
+        COUNTER_HUD_VERTICES,
+        COUNTER_HUD_DRAW_CALLS,
+
+        COUNTER_AMOUNT
+    } Counter;
+
+    constexpr u32 SAMPLE_COUNT = 128; // power of two
+
+    typedef struct
+    {
+        u32 min, average, p99; // in ticks
+    } Stats;
+
+    void record(Zone zone, u32 ticks);
+    Stats stats(Zone zone);
+
+    void count(Counter counter, u32 value);
+
+    // Sorts the zone's samples into bucketCount buckets of bucketTicks each, the last one also takes everything longer
+    void histogram(Zone zone, u32 bucketTicks, u32* buckets, u32 bucketCount);
+
+    // Rolling min/avg/p99 for every zone and a histogram of update times, meant for the bottom screen
+    void drawOverlay(float x, float y, float depth, u32 color);
+
+    class Scope
+    {
+        public:
+            Scope(Zone zone) : zone(zone), start(Platform::ticks()) {}
+            ~Scope() { record(this->zone, Platform::ticks() - this->start); }
+
+        private:
+            Zone zone;
+            u64 start;
+    };
+}
+
+#ifdef PROFILER
+#define PROFILE_ZONE(zone) Profiler::Scope profilerScope(zone)
+#define PROFILE_COUNTER(counter, value) Profiler::count(counter, value)
+#else
+#define PROFILE_ZONE(zone) do {} while(0)
+#define PROFILE_COUNTER(counter, value) ((void)(value))
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "types.h"
+
+// xoshiro128**: small and fast on a 32-bit CPU, and the same numbers on every target for a given seed
+// Every subsystem draws from its own stream, so drawing more in one doesn't change what the others get
+class Random
+{
+    public:
+        typedef enum
+        {
+            STREAM_SPAWN,
+        } Stream;
+
+        Random(u32 seed = 0, u32 stream = 0)
+        {
+            this->seed(seed, stream);
+        }
+
+        // The state is filled by splitmix32, which never gives four zeros in a row
+        void seed(u32 seed, u32 stream)
+        {
+            u32 mix = seed ^ (stream*0x9E3779B9u + 0x632BE5ABu);
+            for(auto& word : this->state)
+            {
+                u32 z = (mix += 0x9E3779B9u);
+                z = (z ^ (z >> 16))*0x85EBCA6Bu;
+                z = (z ^ (z >> 13))*0xC2B2AE35u;
+                word = z ^ (z >> 16);
+            }
+        }
+
+        u32 next()
+        {
+            u32* s = this->state;
+            u32 result = rotate(s[1]*5, 7)*9;
+            u32 t = s[1] << 9;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotate(s[3], 11);
+            return result;
+        }
+
+        // From 0 to bound - 1, by scaling instead of a modulo, so without its division or its bias towards low numbers
+        u32 below(u32 bound)
+        {
+            return ((u64)this->next()*bound) >> 32;
+        }
+
+        // From 0 up to but not including 1
+        float uniform()
+        {
+            return (this->next() >> 8)*(1.0f/(1 << 24));
+        }
+
+    private:
+        static u32 rotate(u32 x, int k)
+        {
+            return (x << k) | (x >> (32 - k));
+        }
+
+        u32 state[4];
+};
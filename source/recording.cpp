@@ -0,0 +1,106 @@
+#include "recording.h"
+#include <cstddef>
+
+namespace Recording
+{
+    static constexpr size_t FRAME_SIZES[VERSION+1] = {0, offsetof(Frame, motion), offsetof(Frame, palette), sizeof(Frame), sizeof(Frame)};
+
+    Writer::~Writer()
+    {
+        this->close();
+    }
+
+    bool Writer::open(const char* path, u32 seed, u64 ticksPerSecond, u32 waves)
+    {
+        this->close();
+
+        this->file = fopen(path, "wb");
+        if(this->file == NULL)
+            return false;
+
+        Header header = {MAGIC, VERSION, sizeof(Frame), seed, waves, ticksPerSecond};
+        if(fwrite(&header, sizeof(header), 1, this->file) != 1)
+        {
+            fclose(this->file);
+            this->file = NULL;
+            return false;
+        }
+        return true;
+    }
+
+    void Writer::write(const Frame& frame)
+    {
+        if(this->file == NULL)
+            return;
+
+        this->batch[this->batched++] = frame;
+        if(this->batched == BATCH_FRAMES)
+            this->flush();
+    }
+
+    void Writer::flush()
+    {
+        fwrite(this->batch, sizeof(Frame), this->batched, this->file);
+        this->batched = 0;
+    }
+
+    void Writer::close()
+    {
+        if(this->file == NULL)
+            return;
+
+        this->flush();
+        fclose(this->file);
+        this->file = NULL;
+    }
+
+    Reader::~Reader()
+    {
+        this->close();
+    }
+
+    bool Reader::open(const char* path)
+    {
+        this->close();
+
+        this->file = fopen(path, "rb");
+        if(this->file == NULL)
+            return false;
+
+        if(fread(&this->fileHeader, sizeof(Header), 1, this->file) != 1
+            || this->fileHeader.magic != MAGIC
+            || this->fileHeader.version < 1
+            || this->fileHeader.version > VERSION
+            || this->fileHeader.frameSize != FRAME_SIZES[this->fileHeader.version])
+        {
+            this->close();
+            return false;
+        }
+        return true;
+    }
+
+    bool Reader::next(Frame* frame)
+    {
+        if(this->file == NULL || fread(frame, this->fileHeader.frameSize, 1, this->file) != 1)
+            return false;
+
+        if(this->fileHeader.version < 2)
+            frame->motion[0] = frame->motion[1] = NO_MOTION;
+        if(this->fileHeader.version < 3)
+        {
+            for(u32 i = 0; i < PALETTE_COLORS; i++)
+                frame->palette[i] = 0;
+            frame->reserved = 0;
+        }
+        return true;
+    }
+
+    void Reader::close()
+    {
+        if(this->file == NULL)
+            return;
+
+        fclose(this->file);
+        this->file = NULL;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "types.h"
+#include <cstdio>
+
+// Binary log of everything the game logic reads from the console, so a session can be played back identically
+// The file is a Header followed by one Frame per update, both stored as-is (little endian on every target we run on)
+namespace Recording
+{
+    constexpr u32 MAGIC = 0x4C524150; // "PARL"
+    // Older frames are a prefix of the current one and still replay, without what was added since:
+    // version 1 stops before motion, version 2 before palette
+    // Before version 4 the game drew its random numbers from rand(), so older logs replay with other spawns
+    constexpr u16 VERSION = 4;
+    constexpr u32 PALETTE_COLORS = 4;
+
+    // Special values of Frame::motion
+    constexpr s16 NO_MOTION = INT16_MIN; // the camera had no new frame
+    constexpr s16 LOST_MOTION = INT16_MIN + 1; // the camera lost track of how it moved
+
+    typedef struct
+    {
+        u32 magic;
+        u16 version;
+        u16 frameSize;
+        u32 seed; // every random stream of the game is seeded from this
+        u32 waves; // checksum of the wave script played, 0 for none
+        u64 ticksPerSecond;
+    } Header;
+
+    typedef struct
+    {
+        u64 tick;
+        u32 seed; // unused since version 4, the streams seeded from the header's carry on from frame to frame
+        u32 keysDown, keysHeld;
+        s16 accel[3]; // x, y, z, as read by hidAccelRead
+        s16 gyro[3]; // x, z, y, as read by hidGyroRead
+        s16 motion[2]; // camera rotation around x and y since the last frame that had some, in hundredths of a degree
+        u32 palette[PALETTE_COLORS]; // most common colors around the player, most common first, 0 when unknown
+        u32 reserved;
+    } Frame;
+
+    static_assert(sizeof(Header) == 24);
+    static_assert(sizeof(Frame) == 56);
+
+    class Writer
+    {
+        public:
+            ~Writer();
+
+            bool open(const char* path, u32 seed, u64 ticksPerSecond, u32 waves = 0);
+            void write(const Frame& frame);
+            void close();
+
+            bool isOpen() const { return this->file != NULL; }
+
+        private:
+            void flush();
+
+            // Frames are written in batches so the SD card isn't touched every frame
+            static constexpr u32 BATCH_FRAMES = 256;
+            Frame batch[BATCH_FRAMES];
+            u32 batched = 0;
+            FILE* file = NULL;
+    };
+
+    class Reader
+    {
+        public:
+            ~Reader();
+
+            // Fails on a missing file or one with the wrong magic, an unknown version or a frame size that doesn't match it
+            bool open(const char* path);
+            bool next(Frame* frame);
+            void close();
+
+            bool isOpen() const { return this->file != NULL; }
+            const Header& header() const { return this->fileHeader; }
+
+        private:
+            Header fileHeader;
+            FILE* file = NULL;
+    };
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "types.h"
+#include <vector>
+#include <cstdint>
+
+// Handles stay valid while other splashes come and go, and stop resolving once theirs is removed
+typedef u32 SplashHandle;
+
+// Struct-of-arrays storage for paint splashes: each property lives in its own contiguous array,
+// live splashes are packed at the front and removal swaps the last one into the hole
+class SplashPool
+{
+    public:
+        static constexpr SplashHandle INVALID_HANDLE = UINT32_MAX;
+        static constexpr u32 INVALID_INDEX = UINT32_MAX;
+
+        enum SplashFlags : u8
+        {
+            FLAG_BOSS = 1 << 0,
+        };
+
+        // Reserving up front means spawning doesn't allocate until capacity is exceeded
+        SplashPool(size_t capacity = 1024)
+        {
+            this->tX.reserve(capacity);
+            this->tY.reserve(capacity);
+            this->tZ.reserve(capacity);
+            this->health.reserve(capacity);
+            this->color.reserve(capacity);
+            this->flags.reserve(capacity);
+            this->indexToSlot.reserve(capacity);
+            this->slots.reserve(capacity);
+            this->freeSlots.reserve(capacity);
+        }
+
+        SplashHandle add(float tX, float tY, float tZ, float health, u32 color, u8 flags)
+        {
+            u32 slot;
+            if(this->freeSlots.empty())
+            {
+                slot = this->slots.size();
+                this->slots.push_back({0, 0});
+            }
+            else
+            {
+                slot = this->freeSlots.back();
+                this->freeSlots.pop_back();
+            }
+
+            u32 index = this->tX.size();
+            this->slots[slot].index = index;
+            this->tX.push_back(tX);
+            this->tY.push_back(tY);
+            this->tZ.push_back(tZ);
+            this->health.push_back(health);
+            this->color.push_back(color);
+            this->flags.push_back(flags);
+            this->indexToSlot.push_back(slot);
+
+            return makeHandle(slot, this->slots[slot].generation);
+        }
+
+        bool remove(SplashHandle handle)
+        {
+            u32 index = this->indexOf(handle);
+            if(index == INVALID_INDEX)
+                return false;
+
+            u32 slot = handle & SLOT_MASK;
+            u32 last = this->tX.size() - 1;
+            if(index != last)
+            {
+                this->tX[index] = this->tX[last];
+                this->tY[index] = this->tY[last];
+                this->tZ[index] = this->tZ[last];
+                this->health[index] = this->health[last];
+                this->color[index] = this->color[last];
+                this->flags[index] = this->flags[last];
+                this->indexToSlot[index] = this->indexToSlot[last];
+                this->slots[this->indexToSlot[index]].index = index;
+            }
+            this->tX.pop_back();
+            this->tY.pop_back();
+            this->tZ.pop_back();
+            this->health.pop_back();
+            this->color.pop_back();
+            this->flags.pop_back();
+            this->indexToSlot.pop_back();
+
+            // Bumping the generation invalidates every handle still pointing at this slot
+            this->slots[slot].generation = (this->slots[slot].generation + 1) & GENERATION_MASK;
+            this->freeSlots.push_back(slot);
+            return true;
+        }
+
+        void clear()
+        {
+            while(!this->indexToSlot.empty())
+                this->remove(this->handleAt(0));
+        }
+
+        // Position of the splash in the arrays, or INVALID_INDEX if the handle is stale
+        u32 indexOf(SplashHandle handle) const
+        {
+            u32 slot = handle & SLOT_MASK;
+            if(handle == INVALID_HANDLE || slot >= this->slots.size() || this->slots[slot].generation != handle >> SLOT_BITS)
+                return INVALID_INDEX;
+            return this->slots[slot].index;
+        }
+
+        SplashHandle handleAt(u32 index) const
+        {
+            u32 slot = this->indexToSlot[index];
+            return makeHandle(slot, this->slots[slot].generation);
+        }
+
+        size_t size() const { return this->tX.size(); }
+
+        // Indexed by indexOf(), only valid until the next add or remove
+        float* anglesX() { return this->tX.data(); }
+        float* anglesY() { return this->tY.data(); }
+        float* anglesZ() { return this->tZ.data(); }
+        float* healths() { return this->health.data(); }
+        u32* colors() { return this->color.data(); }
+        u8* flagBits() { return this->flags.data(); }
+
+    private:
+        static constexpr u32 SLOT_BITS = 20;
+        static constexpr u32 SLOT_MASK = (1 << SLOT_BITS) - 1;
+        static constexpr u32 GENERATION_MASK = (1 << (32 - SLOT_BITS)) - 1;
+
+        static SplashHandle makeHandle(u32 slot, u32 generation)
+        {
+            return (generation << SLOT_BITS) | slot;
+        }
+
+        struct Slot
+        {
+            u32 index;
+            u32 generation;
+        };
+
+        std::vector<float> tX, tY, tZ; // angle from normal
+        std::vector<float> health;
+        std::vector<u32> color;
+        std::vector<u8> flags;
+        std::vector<u32> indexToSlot;
+
+        std::vector<Slot> slots;
+        std::vector<u32> freeSlots;
+};
@@ -0,0 +1,98 @@
+#include "startup.h"
+
+Startup::Startup() : count(0)
+{
+    this->begin = Platform::ticks();
+    for(u32 i = 0; i < MILESTONE_AMOUNT; i++)
+        this->milestones[i] = 0;
+}
+
+void Startup::runNow(const char* name, void (*function)(void* data), void* data)
+{
+    TaskId id = this->add(name, function, data);
+    if(id == INVALID_TASK)
+        function(data);
+    else
+        this->time(this->tasks[id]);
+}
+
+Startup::TaskId Startup::add(const char* name, void (*function)(void* data), void* data)
+{
+    if(this->count == MAX_TASKS)
+        return INVALID_TASK;
+
+    Task& task = this->tasks[this->count];
+    task.startup = this;
+    task.function = function;
+    task.data = data;
+    task.dependencyCount = 0;
+    task.timing = {name, 0, 0};
+    return this->count++;
+}
+
+bool Startup::depend(TaskId task, TaskId on)
+{
+    if(task >= this->count || on >= this->count || this->tasks[task].dependencyCount == MAX_TASKS)
+        return false;
+
+    Task& dependent = this->tasks[task];
+    dependent.dependencies[dependent.dependencyCount++] = on;
+    return true;
+}
+
+// Tasks already done, like the ones run right away, are left out of the graph
+void Startup::run(JobSystem* jobs)
+{
+    JobSystem::JobId ids[MAX_TASKS];
+    for(TaskId id = 0; id < this->count; id++)
+        if(this->tasks[id].timing.end == 0)
+            ids[id] = jobs->add(runTask, &this->tasks[id]);
+
+    for(TaskId id = 0; id < this->count; id++)
+    {
+        Task& task = this->tasks[id];
+        if(task.timing.end != 0)
+            continue;
+        for(u32 i = 0; i < task.dependencyCount; i++)
+            if(this->tasks[task.dependencies[i]].timing.end == 0)
+                jobs->depend(ids[id], ids[task.dependencies[i]]);
+    }
+
+    jobs->run();
+}
+
+void Startup::runTask(void* data)
+{
+    Task* task = (Task*)data;
+    task->startup->time(*task);
+}
+
+// A task finishing on the very tick it began still ends after 0
+void Startup::time(Task& task)
+{
+    task.timing.start = Platform::ticks() - this->begin;
+    task.function(task.data);
+    u64 end = Platform::ticks() - this->begin;
+    task.timing.end = end > task.timing.start ? end : task.timing.start + 1;
+}
+
+void Startup::reach(Milestone milestone)
+{
+    if(this->milestones[milestone] == 0)
+        this->milestones[milestone] = Platform::ticks() - this->begin + 1;
+}
+
+void Startup::report() const
+{
+    static const char* const MILESTONE_NAMES[MILESTONE_AMOUNT] = {"first frame", "first camera frame"};
+    auto ms = [](u64 ticks) { return (double)ticks*1000/Platform::TICKS_PER_SECOND; };
+
+    for(TaskId id = 0; id < this->count; id++)
+    {
+        const Timing& timing = this->tasks[id].timing;
+        DEBUG("startup: %-10s at %8.2f ms, took %8.2f ms\n", timing.name, ms(timing.start), ms(timing.end - timing.start));
+    }
+    for(u32 i = 0; i < MILESTONE_AMOUNT; i++)
+        if(this->reached((Milestone)i))
+            DEBUG("startup: %-18s at %8.2f ms\n", MILESTONE_NAMES[i], ms(this->milestones[i]));
+}
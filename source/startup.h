@@ -0,0 +1,72 @@
+#pragma once
+
+#include "common.h"
+#include "jobs.h"
+
+// Brings the game up as a graph of tasks on the job system, so that loading, parsing and waiting on the hardware overlap,
+// and times every task and the first frames against when it began, for tracking how long the game takes to show up
+class Startup
+{
+    public:
+        typedef u32 TaskId;
+        static constexpr u32 MAX_TASKS = 16;
+        static constexpr TaskId INVALID_TASK = UINT32_MAX;
+
+        typedef enum
+        {
+            MILESTONE_FIRST_FRAME, // shown on the screens
+            MILESTONE_CAMERA, // the first one with a camera picture
+
+            MILESTONE_AMOUNT
+        } Milestone;
+
+        typedef struct
+        {
+            const char* name;
+            u64 start, end; // ticks since the beginning, end is 0 until it's done
+        } Timing;
+
+        // Everything is timed from here
+        Startup();
+
+        // Runs a task right away on this thread, for what has to be up before the job system, untimed past MAX_TASKS
+        void runNow(const char* name, void (*function)(void* data), void* data);
+
+        // INVALID_TASK once MAX_TASKS have been added
+        TaskId add(const char* name, void (*function)(void* data), void* data);
+        // task won't start before on has finished
+        // Leaves task alone and returns false if either isn't a task, or task already has MAX_TASKS dependencies
+        bool depend(TaskId task, TaskId on);
+        // Runs every added task and returns once they're all done
+        void run(JobSystem* jobs);
+
+        // Only the first time counts
+        void reach(Milestone milestone);
+        bool reached(Milestone milestone) const { return this->milestones[milestone] != 0; }
+        u64 milestone(Milestone milestone) const { return this->milestones[milestone]; } // ticks since the beginning
+
+        u32 taskCount() const { return this->count; }
+        const Timing& timing(TaskId task) const { return this->tasks[task].timing; }
+
+        // Prints every task's start and length, then the milestones reached, in milliseconds
+        void report() const;
+
+    private:
+        typedef struct
+        {
+            Startup* startup;
+            void (*function)(void* data);
+            void* data;
+            TaskId dependencies[MAX_TASKS];
+            u32 dependencyCount;
+            Timing timing;
+        } Task;
+
+        static void runTask(void* data);
+        void time(Task& task);
+
+        u64 begin;
+        Task tasks[MAX_TASKS];
+        u32 count;
+        u64 milestones[MILESTONE_AMOUNT];
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "types.h"
+#include <algorithm>
+
+// Per-eye placement for the 3D top screen, the camera pictures bring their own depth and everything drawn over them is moved apart
+namespace Stereo
+{
+    typedef enum
+    {
+        EYE_LEFT,
+        EYE_RIGHT,
+
+        EYE_AMOUNT
+    } Eye;
+
+    // How far apart the two eyes' pictures of something as close as it gets are, in pixels, with the slider all the way up
+    constexpr float MAX_PARALLAX = 12.0f;
+
+    // Horizontal shift of one eye's picture, slider from 0 (2D) to 1, depth from 0 (on the screen) to 1 (as close as it gets)
+    // Things in front of the screen are seen crossed: more to the right by the left eye and more to the left by the right one
+    inline float eyeOffset(Eye eye, float slider, float depth)
+    {
+        float shift = std::clamp(slider, 0.0f, 1.0f)*std::clamp(depth, 0.0f, 1.0f)*MAX_PARALLAX/2;
+        return eye == EYE_LEFT ? shift : -shift;
+    }
+}
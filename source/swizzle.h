@@ -0,0 +1,107 @@
+#pragma once
+
+#include "types.h"
+#include <array>
+
+// The GPU wants textures as 8x8 tiles, with the pixels inside a tile in Morton (Z) order
+namespace Swizzle
+{
+    constexpr u32 TILE_SIZE = 8;
+    constexpr u32 TILE_PIXELS = TILE_SIZE*TILE_SIZE;
+
+    constexpr u32 mortonOffset(u32 x, u32 y)
+    {
+        return (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2) | ((x & 4) << 2) | ((y & 4) << 3);
+    }
+
+    // x and x+1 only differ in bit 0 of the Morton offset, so every horizontal pair of pixels is contiguous in the tile
+    // pairOffsets[y][k] is where the pair (2k, y) lands, counted in pairs
+    constexpr auto pairOffsets = [](){
+        std::array<std::array<u8, TILE_SIZE/2>, TILE_SIZE> table{};
+        for(u32 y = 0; y < TILE_SIZE; y++)
+            for(u32 k = 0; k < TILE_SIZE/2; k++)
+                table[y][k] = mortonOffset(k*2, y)/2;
+        return table;
+    }();
+
+    typedef enum
+    {
+        FORMAT_RGB565,
+        FORMAT_RGBA5551,
+        FORMAT_RGBA8,
+    } PixelFormat;
+
+    template<PixelFormat format> struct Pixel;
+    template<> struct Pixel<FORMAT_RGB565> { typedef u16 type; };
+    template<> struct Pixel<FORMAT_RGBA5551> { typedef u16 type; };
+    template<> struct Pixel<FORMAT_RGBA8> { typedef u32 type; };
+
+    typedef u32 __attribute__((may_alias)) aliased_u32;
+
+    // Copies one 8x8 block of a linear image into one tile
+    template<PixelFormat format>
+    struct TileConverter
+    {
+        typedef typename Pixel<format>::type pixel;
+
+        static inline void convert(const pixel* src, u32 srcStride, pixel* dst)
+        {
+            for(u32 y = 0; y < TILE_SIZE; y++, src += srcStride)
+                for(u32 x = 0; x < TILE_SIZE; x++)
+                    dst[mortonOffset(x, y)] = src[x];
+        }
+    };
+
+    // 16bpp formats move a pair of pixels per word
+    template<typename pixel>
+    struct PairTileConverter
+    {
+        static_assert(sizeof(pixel)*2 == sizeof(u32));
+
+        static inline void convert(const pixel* src, u32 srcStride, pixel* dst)
+        {
+            aliased_u32* dstPairs = (aliased_u32*)dst;
+            for(u32 y = 0; y < TILE_SIZE; y++, src += srcStride)
+            {
+                const aliased_u32* srcPairs = (const aliased_u32*)src;
+                const auto& offsets = pairOffsets[y];
+                dstPairs[offsets[0]] = srcPairs[0];
+                dstPairs[offsets[1]] = srcPairs[1];
+                dstPairs[offsets[2]] = srcPairs[2];
+                dstPairs[offsets[3]] = srcPairs[3];
+            }
+        }
+    };
+
+    template<> struct TileConverter<FORMAT_RGB565> : PairTileConverter<u16> {};
+    template<> struct TileConverter<FORMAT_RGBA5551> : PairTileConverter<u16> {};
+
+    // Converts the rows of tiles [firstTileRow, firstTileRow+tileRows) of a linear srcWidth wide image into a dstWidth wide tiled texture
+    // Separate ranges touch separate memory, so they can be converted on different threads
+    // Only the first width pixels of each row are converted, for smaller pictures kept in a srcWidth wide buffer
+    template<PixelFormat format, u32 srcWidth, u32 dstWidth>
+    void convertTileRows(const typename Pixel<format>::type* src, typename Pixel<format>::type* dst, u32 firstTileRow, u32 tileRows, u32 width = srcWidth)
+    {
+        static_assert(srcWidth % TILE_SIZE == 0 && dstWidth % TILE_SIZE == 0);
+        static_assert(srcWidth <= dstWidth);
+
+        const u32 srcTilesPerRow = width/TILE_SIZE;
+        constexpr u32 dstTilesPerRow = dstWidth/TILE_SIZE;
+        for(u32 tileY = firstTileRow; tileY < firstTileRow + tileRows; tileY++)
+        {
+            const auto* srcRow = src + tileY*TILE_SIZE*srcWidth;
+            auto* dstRow = dst + tileY*dstTilesPerRow*TILE_PIXELS;
+            for(u32 tileX = 0; tileX < srcTilesPerRow; tileX++)
+                TileConverter<format>::convert(srcRow + tileX*TILE_SIZE, srcWidth, dstRow + tileX*TILE_PIXELS);
+        }
+    }
+
+    // Converts a whole linear srcWidth*srcHeight image into a dstWidth wide tiled texture, a tile at a time
+    // Both widths and the height have to be multiples of 8, and the buffers word aligned
+    template<PixelFormat format, u32 srcWidth, u32 srcHeight, u32 dstWidth>
+    void convertFrame(const typename Pixel<format>::type* src, typename Pixel<format>::type* dst)
+    {
+        static_assert(srcHeight % TILE_SIZE == 0);
+        convertTileRows<format, srcWidth, dstWidth>(src, dst, 0, srcHeight/TILE_SIZE);
+    }
+}
@@ -0,0 +1,55 @@
+#include "text_cache.h"
+
+void TextCache::init(size_t slotCount, size_t capacity)
+{
+    for(size_t i = 0; i < slotCount; i++)
+        this->slots.push_back(Platform::createText(capacity));
+
+    char digit[2] = {0};
+    for(int i = 0; i < 10; i++)
+    {
+        digit[0] = '0' + i;
+        this->digits[i] = Platform::createText(digit);
+        this->digitWidths[i] = Platform::textWidth(this->digits[i], 1.0f);
+    }
+    this->minus = Platform::createText("-");
+    this->minusWidth = Platform::textWidth(this->minus, 1.0f);
+}
+
+void TextCache::exit()
+{
+    for(auto text : this->slots)
+        Platform::deleteText(text);
+    this->slots.clear();
+
+    for(auto text : this->digits)
+        Platform::deleteText(text);
+    Platform::deleteText(this->minus);
+}
+
+void TextCache::draw(u32 slot, const char* string, float x, float y, float depth, float scale, u32 color)
+{
+    Platform::setText(this->slots[slot], string);
+    Platform::drawText(this->slots[slot], x, y, depth, scale, color);
+}
+
+void TextCache::drawNumber(int number, float x, float y, float depth, float scale, u32 color)
+{
+    u32 value = number < 0 ? -(u32)number : number;
+    if(number < 0)
+    {
+        Platform::drawText(this->minus, x, y, depth, scale, color);
+        x += this->minusWidth*scale;
+    }
+
+    u32 big = 1;
+    while(value/big >= 10)
+        big *= 10;
+
+    for(; big != 0; big /= 10)
+    {
+        int digit = (value/big) % 10;
+        Platform::drawText(this->digits[digit], x, y, depth, scale, color);
+        x += this->digitWidths[digit]*scale;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.h"
+#include <vector>
+
+// Keeps parsed text around between frames: every slot is only parsed again when the string drawn in it changes,
+// and numbers are put together from ten digits parsed once
+class TextCache
+{
+    public:
+        void init(size_t slotCount, size_t capacity);
+        void exit();
+
+        void draw(u32 slot, const char* string, float x, float y, float depth, float scale, u32 color);
+        void drawNumber(int number, float x, float y, float depth, float scale, u32 color);
+
+    private:
+        std::vector<Platform::Text> slots;
+        Platform::Text digits[10], minus;
+        float digitWidths[10], minusWidth; // at scale 1
+};
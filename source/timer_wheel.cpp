@@ -0,0 +1,136 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel()
+{
+    this->reset();
+}
+
+void TimerWheel::reset(u64 now)
+{
+    this->nodes.clear();
+    this->freeNodes = NONE;
+    for(auto& level : this->slots)
+        for(auto& slot : level)
+            slot = {NONE, NONE};
+    this->late = {NONE, NONE};
+    this->current = now;
+    this->count = 0;
+    this->sequence = 0;
+}
+
+void TimerWheel::append(List& list, u32 node)
+{
+    this->nodes[node].next = NONE;
+    if(list.tail == NONE)
+        list.head = node;
+    else
+        this->nodes[list.tail].next = node;
+    list.tail = node;
+}
+
+// The level is picked by how far ahead the event is, the slot by its own time, so a slot of an upper level
+// holds a whole turn of the one below and is spread over it just as that turn starts
+void TimerWheel::insert(u32 node)
+{
+    u64 time = this->nodes[node].event.time;
+    if(time <= this->current)
+    {
+        this->append(this->late, node);
+        return;
+    }
+
+    u64 delta = time - this->current;
+    if(delta >= RANGE)
+        time = this->current + RANGE - 1;
+
+    u32 level = 0;
+    while(level + 1 < LEVELS && delta >= 1ull << (SLOT_BITS*(level + 1)))
+        level++;
+    this->append(this->slots[level][(time >> (SLOT_BITS*level)) & MASK], node);
+}
+
+void TimerWheel::schedule(u64 time, u32 type, u32 argument)
+{
+    u32 node = this->freeNodes;
+    if(node == NONE)
+    {
+        node = this->nodes.size();
+        this->nodes.emplace_back();
+    }
+    else
+    {
+        this->freeNodes = this->nodes[node].next;
+    }
+
+    this->nodes[node].event = {time, type, argument};
+    this->nodes[node].sequence = this->sequence++;
+    this->count++;
+    this->insert(node);
+}
+
+// Hands every event of the list over to due, in scheduling order, and frees their nodes
+void TimerWheel::collect(List& list, std::vector<Event>& due)
+{
+    this->batch.clear();
+    for(u32 node = list.head; node != NONE; node = this->nodes[node].next)
+        this->batch.push_back(node);
+    list = {NONE, NONE};
+
+    std::sort(this->batch.begin(), this->batch.end(), [this](u32 a, u32 b) {
+        const Node& first = this->nodes[a];
+        const Node& second = this->nodes[b];
+        return first.event.time != second.event.time ? first.event.time < second.event.time : first.sequence < second.sequence;
+    });
+    for(u32 node : this->batch)
+    {
+        due.push_back(this->nodes[node].event);
+        this->nodes[node].next = this->freeNodes;
+        this->freeNodes = node;
+    }
+    this->count -= this->batch.size();
+}
+
+void TimerWheel::advance(u64 now, std::vector<Event>& due)
+{
+    this->collect(this->late, due);
+
+    while(this->current < now)
+    {
+        // Nothing left to find on the way
+        if(this->count == 0)
+        {
+            this->current = now;
+            break;
+        }
+
+        this->current++;
+        // Every level whose turn just started is spread over the ones below
+        for(u32 level = 1; level < LEVELS && ((this->current >> (SLOT_BITS*(level - 1))) & MASK) == 0; level++)
+        {
+            List& slot = this->slots[level][(this->current >> (SLOT_BITS*level)) & MASK];
+            u32 node = slot.head;
+            slot = {NONE, NONE};
+            while(node != NONE)
+            {
+                u32 next = this->nodes[node].next;
+                this->insert(node);
+                node = next;
+            }
+        }
+        // Spreading the levels puts what is due right now with the late events, they all go out together
+        List& slot = this->slots[0][this->current & MASK];
+        if(slot.head != NONE)
+        {
+            if(this->late.tail == NONE)
+                this->late = slot;
+            else
+            {
+                this->nodes[this->late.tail].next = slot.head;
+                this->late.tail = slot.tail;
+            }
+            slot = {NONE, NONE};
+        }
+        this->collect(this->late, due);
+    }
+}
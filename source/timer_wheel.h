@@ -0,0 +1,64 @@
+#pragma once
+
+#include "types.h"
+#include <vector>
+
+// Events scheduled at a tick, kept in a hierarchy of wheels so that moving time forward costs the same however many are pending
+// The first level has a slot per tick, each level above a slot per whole turn of the one below; a slot of an upper level
+// is spread over the levels below once time reaches it, so every event is only ever moved once per level
+class TimerWheel
+{
+    public:
+        static constexpr u32 SLOT_BITS = 6;
+        static constexpr u32 SLOTS = 1 << SLOT_BITS;
+        static constexpr u32 LEVELS = 4;
+        static constexpr u64 RANGE = 1ull << (SLOT_BITS*LEVELS); // ticks ahead the levels cover, later events go round the last one again
+
+        typedef struct
+        {
+            u64 time;
+            u32 type, argument; // whatever the user makes of them
+        } Event;
+
+        TimerWheel();
+
+        // Drops every event and starts over at now
+        void reset(u64 now = 0);
+        // Events at or before the current time are due on the next advance
+        void schedule(u64 time, u32 type, u32 argument);
+        // Moves time forward to now, adding every event due by then to due, earliest first and in the order they were scheduled for a same tick
+        void advance(u64 now, std::vector<Event>& due);
+
+        u64 time() const { return this->current; }
+        u32 pending() const { return this->count; }
+
+    private:
+        static constexpr u32 NONE = UINT32_MAX;
+        static constexpr u32 MASK = SLOTS - 1;
+
+        typedef struct
+        {
+            Event event;
+            u32 sequence; // order of scheduling, for events of a same tick
+            u32 next;
+        } Node;
+
+        typedef struct
+        {
+            u32 head, tail;
+        } List;
+
+        void insert(u32 node);
+        void append(List& list, u32 node);
+        void collect(List& list, std::vector<Event>& due);
+
+        std::vector<Node> nodes;
+        u32 freeNodes; // list of unused nodes, through next
+        List slots[LEVELS][SLOTS];
+        List late; // scheduled for a time already gone
+
+        u64 current;
+        u32 count;
+        u32 sequence;
+        std::vector<u32> batch; // scratch space for collect
+};
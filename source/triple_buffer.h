@@ -0,0 +1,50 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+
+// Lock-free single producer, single consumer handoff over three slots
+// The producer always has a slot to write into, the consumer always has a complete one to read,
+// and the third one is swapped between them with a single atomic operation
+template<typename T>
+class TripleBuffer
+{
+    public:
+        TripleBuffer(T* first, T* second, T* third) : slots{first, second, third}, state(1), writeIndex(0), readIndex(2), writeSequence(0), readSequence(0) {}
+
+        // Producer side
+        T* writeBuffer() { return this->slots[this->writeIndex]; }
+        void publish()
+        {
+            u32 newState = (++this->writeSequence << SEQUENCE_SHIFT) | FRESH_BIT | this->writeIndex;
+            this->writeIndex = this->state.exchange(newState, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        // Consumer side, returns false (and keeps the current slot) if nothing was published since the last call
+        bool acquire()
+        {
+            u32 current = this->state.load(std::memory_order_relaxed);
+            do
+            {
+                if(!(current & FRESH_BIT))
+                    return false;
+            } while(!this->state.compare_exchange_weak(current, (current & ~(FRESH_BIT | INDEX_MASK)) | this->readIndex, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+            this->readIndex = current & INDEX_MASK;
+            this->readSequence = current >> SEQUENCE_SHIFT;
+            return true;
+        }
+        const T* readBuffer() const { return this->slots[this->readIndex]; }
+        u32 sequence() const { return this->readSequence; }
+
+    private:
+        static constexpr u32 INDEX_MASK = 0x3;
+        static constexpr u32 FRESH_BIT = 0x4;
+        static constexpr u32 SEQUENCE_SHIFT = 3;
+
+        T* slots[3];
+        std::atomic<u32> state; // sequence << SEQUENCE_SHIFT | FRESH_BIT | index of the shared slot
+
+        u32 writeIndex, readIndex; // owned by the producer and the consumer respectively
+        u32 writeSequence, readSequence;
+};
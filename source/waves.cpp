@@ -0,0 +1,70 @@
+#include "waves.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+namespace Waves
+{
+    bool parse(const char* text, std::vector<Spawn>& spawns)
+    {
+        std::vector<Spawn> parsed;
+        while(*text)
+        {
+            const char* end = strchr(text, '\n');
+            size_t length = end ? end - text : strlen(text);
+
+            char line[128];
+            if(length >= sizeof(line))
+                return false;
+            memcpy(line, text, length);
+            line[length] = '\0';
+            text += end ? length + 1 : length;
+
+            char* start = line + strspn(line, " \t\r");
+            if(*start == '\0' || *start == '#')
+                continue;
+
+            Spawn spawn;
+            char kind[8];
+            if(sscanf(start, "%f %7s %f %f", &spawn.seconds, kind, &spawn.tX, &spawn.tY) != 4 || spawn.seconds < 0)
+                return false;
+            if(!strcmp(kind, "boss"))
+                spawn.boss = true;
+            else if(!strcmp(kind, "splash"))
+                spawn.boss = false;
+            else
+                return false;
+            parsed.push_back(spawn);
+        }
+
+        spawns.insert(spawns.end(), parsed.begin(), parsed.end());
+        return true;
+    }
+
+    bool load(const char* path, std::vector<Spawn>& spawns, u32* checksum)
+    {
+        FILE* file = fopen(path, "rb");
+        if(file == NULL)
+            return false;
+
+        std::vector<char> text;
+        char buffer[4096];
+        size_t read;
+        while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            text.insert(text.end(), buffer, buffer + read);
+        fclose(file);
+
+        *checksum = Waves::checksum(text.data(), text.size());
+        text.push_back('\0');
+        return parse(text.data(), spawns);
+    }
+
+    // FNV-1a, never 0 so that 0 can mean no script
+    u32 checksum(const char* data, size_t size)
+    {
+        u32 hash = 2166136261u;
+        for(size_t i = 0; i < size; i++)
+            hash = (hash ^ (u8)data[i])*16777619u;
+        return hash ? hash : 1;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "types.h"
+#include <vector>
+
+// Scripted spawns, one per line: the second of play it happens at, "splash" or "boss", then where in degrees, like
+//   12.5 splash 30 -45
+// Empty lines and lines starting with # are skipped
+namespace Waves
+{
+    typedef struct
+    {
+        float seconds;
+        float tX, tY;
+        bool boss;
+    } Spawn;
+
+    // Returns false, leaving spawns as they were, at the first line that can't be read
+    bool parse(const char* text, std::vector<Spawn>& spawns);
+    // Also gives the file's checksum, which recordings keep so a replay can tell it's given another script
+    bool load(const char* path, std::vector<Spawn>& spawns, u32* checksum);
+    u32 checksum(const char* data, size_t size);
+}
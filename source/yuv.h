@@ -0,0 +1,68 @@
+#pragma once
+
+#include "types.h"
+#include "swizzle.h"
+#include <algorithm>
+
+// YUV422 camera pictures to RGB, doing the same fixed point steps as the Y2R unit so both give the same pixels
+// Pixels are stored as u16 like RGB565 ones: Y in the low byte, then U for even pixels and V for odd ones in the high byte
+namespace Yuv
+{
+    // Y2RU_SetStandardCoefficient's COEFFICIENT_ITU_R_BT_601, the cameras' full range YUV
+    // Y, V to R, V to G, U to G, U to B in 8.8 fixed point, then the R, G and B offsets in 11.5
+    constexpr s32 COEFFICIENTS[8] = {0x100, 0x166, 0xB6, 0x58, 0x1C5, -0x166F, 0x10EE, -0x1C5B};
+
+    inline u8 clampChannel(s32 value)
+    {
+        return std::clamp(value >> 5, 0, 0xFF);
+    }
+
+    inline void toRgb(s32 y, s32 u, s32 v, u8* r, u8* g, u8* b)
+    {
+        constexpr s32 ROUNDING = 0x18;
+        const s32* c = COEFFICIENTS;
+        s32 scaledY = c[0]*y;
+        *r = clampChannel(((scaledY + c[1]*v) >> 3) + c[5] + ROUNDING);
+        *g = clampChannel(((scaledY - c[2]*v - c[3]*u) >> 3) + c[6] + ROUNDING);
+        *b = clampChannel(((scaledY + c[4]*u) >> 3) + c[7] + ROUNDING);
+    }
+
+    inline u16 toRgb565(s32 y, s32 u, s32 v)
+    {
+        u8 r, g, b;
+        toRgb(y, u, v, &r, &g, &b);
+        return (r >> 3) << 11 | (g >> 2) << 5 | (b >> 3);
+    }
+
+    // Same as Swizzle::convertTileRows, converting every pixel to RGB565 on the way, for when there is no Y2R unit to do it
+    template<u32 srcWidth, u32 dstWidth>
+    void convertTileRows(const u16* src, u16* dst, u32 firstTileRow, u32 tileRows, u32 width = srcWidth)
+    {
+        using Swizzle::TILE_SIZE;
+        using Swizzle::TILE_PIXELS;
+        static_assert(srcWidth % TILE_SIZE == 0 && dstWidth % TILE_SIZE == 0);
+        static_assert(srcWidth <= dstWidth);
+
+        constexpr u32 dstTilesPerRow = dstWidth/TILE_SIZE;
+        for(u32 tileY = firstTileRow; tileY < firstTileRow + tileRows; tileY++)
+        {
+            const u16* srcRow = src + tileY*TILE_SIZE*srcWidth;
+            u16* dstRow = dst + tileY*dstTilesPerRow*TILE_PIXELS;
+            for(u32 tileX = 0; tileX < width/TILE_SIZE; tileX++)
+            {
+                const u16* block = srcRow + tileX*TILE_SIZE;
+                u16* tile = dstRow + tileX*TILE_PIXELS;
+                for(u32 y = 0; y < TILE_SIZE; y++, block += srcWidth)
+                {
+                    // Each pair of pixels shares its U and V
+                    for(u32 x = 0; x < TILE_SIZE; x += 2)
+                    {
+                        s32 u = block[x] >> 8, v = block[x+1] >> 8;
+                        tile[Swizzle::mortonOffset(x, y)] = toRgb565(block[x] & 0xFF, u, v);
+                        tile[Swizzle::mortonOffset(x+1, y)] = toRgb565(block[x+1] & 0xFF, u, v);
+                    }
+                }
+            }
+        }
+    }
+}